@@ -1,7 +1,7 @@
 #!/bin/bash
 
 # build dll
-clang -g -I ./ -Wall -Wshadow -Wno-unused-variable --shared -fPIC test.c -o ./code.dll -pthread
+clang -g -I ./ -Wall -Wshadow -Wno-unused-variable --shared -fPIC test.c -o ./code.dll -pthread -lm
 
 # build exe
 clang -g -I ./ -g $(sdl2-config --cflags) -fPIC -L$(pwd) -lSDL2 -lGL -lGLEW main.c -o main
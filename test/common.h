@@ -1,9 +1,23 @@
 #pragma once
 
 #define TEXTURE_COUNT 1 // only one big texture atlas for now
+#define DIRTY_TILE_SIZE 16 // only tiles of the atlas that changed get uploaded
 
 typedef struct state_t
 {
     texture_t tex[TEXTURE_COUNT];
     texer_t texer; // used for generating textures
+
+    /* baked animation, see bake_textures() */
+    texture_t frames;      // one frame per layer
+    uint*     frame_tiles; // layer to sample for every frame and tile
+
+    /* partial uploads, see texture_dirty_tiles() */
+    unsigned long long* tile_hashes;
+    uint*               dirty_tiles; // tiles of tex[0] that changed in the last generate_textures()
+    uint                dirty_count;
+
+    /* generation that is spread over several frames, see generate_textures() */
+    uint  next_tile;  // first tile of the atlas that is not generated yet
+    float frame_time; // animation time the atlas in progress is generated for
 } state_t;
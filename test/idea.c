@@ -1,47 +1,38 @@
+#define TEXER_IMPLEMENTATION
+#include "../texer.h"
+
 #include <stdio.h>
-#include <stdarg.h>
-#include <string.h>
-#include <assert.h>
+
+static color_t RED   = {1,0,0,1};
+static color_t BLUE  = {0,0,1,1};
+static color_t GREEN = {0,1,0,1};
 
 #define CHAR_TO_COLOR_TABLE(X) \
     X('#', RED)\
     X(' ', BLUE)\
     X('-', GREEN)\
 
-#define tex_from_string(...) _tex_from_string(__VA_ARGS__+0, (void*)0)
-
-void _tex_from_string(const char* first, ...) {
-    const char* ptr;
+int main() {
+    /* NOTE: not static, the colors are variables and not constant expressions */
+    const color_t palette[256] = { CHAR_TO_COLOR_TABLE(TEXER_PALETTE_ENTRY) };
 
-    size_t buf_size = 0;
+    texture_t stamp = texture_from_string(palette, "####",
+                                                   "#--#",
+                                                   "#  #",
+                                                   "####");
 
-    va_list args;
-    va_start(args, first);
-    for (ptr = first; ptr != NULL ; ptr = va_arg(args,char*)) { buf_size += strlen(ptr); }
-    va_end(args);
+    /* stamp it 4x bigger */
+    texture_t tex;
+    texer(tex, texture(16, 16)) {
+        blit_scaled(stamp, 0, 0, 4);
+    }
 
-    va_start(args, first);
-    size_t last_width = strlen(first);
-    for (ptr = first; ptr != NULL ; ptr = va_arg(args,char*))
-    {
-        assert(last_width == strlen(ptr)); // texture needs to be rectangular
-        last_width = strlen(ptr);
-        for (int i = 0; i < strlen(ptr); i++) {
-            switch(ptr[i]) {
-              #define COLOR_FROM_CHAR(character,color) case (character): { printf("%s ", #color); } break;
-              CHAR_TO_COLOR_TABLE(COLOR_FROM_CHAR)
-              default: { printf("Char not in colormap\n"); } break;
-            }
+    for (uint y = 0; y < tex.height; y++) {
+        for (uint x = 0; x < tex.width; x++) {
+            color_t c = tex.rgb[texture_index(tex, 0, x, y)];
+            printf("%c", c.r > 0 ? '#' : c.g > 0 ? '-' : ' ');
         }
         printf("\n");
     }
-    va_end(args);
-}
-
-int main() {
-    tex_from_string("####",
-                    "#--#",
-                    "#--#",
-                    "####");
     return 0;
 }
@@ -6,12 +6,15 @@
 #include "common.h" // contains shared state definition
 
 #include <assert.h>
+#include <string.h> // for strcmp, memcmp
+#include <stdlib.h> // for atoi
 
 /* HOT RELOAD */
 #include <sys/stat.h>
 #define DLL_FILENAME "./code.dll"
-static int    (*generate_textures)(state_t*, float);
+static int    (*generate_textures)(state_t*, float, float);
 static int    (*alloc_texture)(state_t*);
+static int    (*bake_textures)(state_t*, int);
 static time_t dll_last_mod;
 static void*  dll_handle;
 static state_t* state = NULL;
@@ -22,6 +25,8 @@ static SDL_Window* window;
 #define WINDOW_WIDTH  512
 #define WINDOW_HEIGHT 512
 
+#define GENERATE_BUDGET 0.008f // seconds per frame spent on generating, the atlas is finished over several frames if needed
+
 #define SHADER_STRINGIFY(x) "#version 330\n" #x
 const char* vertex_shader_source = SHADER_STRINGIFY(
 
@@ -121,11 +126,41 @@ GLuint compile_shader(GLenum type, const char* source) {
     return shader;
 }
 
+/* persistently mapped pixel buffer the atlas is generated into, 0 if unsupported or disabled with --no-pbo */
+static GLuint pbo;
+static GLsync upload_fence;   // the gpu is done reading the pbo once this is signaled
+static int    verify_uploads; // --verify: read the texture back after every upload and compare
+
 int upload_textures(state_t* state)
 {
-    //glTexImage2D(GL_TEXTURE_2D, 0, tex_mode, state->tex.width, state->tex.height, 0, tex_mode, GL_UNSIGNED_BYTE, state->tex.rgb);
-    glTexImage2D(GL_TEXTURE_2D, 0, tex_mode, state->tex[0].width, state->tex[0].height, 0, GL_RGBA, GL_FLOAT, state->tex[0].rgb);
-    //glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels);
+    texture_t tex = state->tex[0];
+    uint tiles_x  = (tex.width + DIRTY_TILE_SIZE - 1) / DIRTY_TILE_SIZE;
+
+    /* only tiles that changed, storage is allocated once at startup. NOTE: the atlas is flipped, so tiles
+     * in storage order are already in OpenGL's bottom-up coordinates */
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, tex.width);
+    for (uint i = 0; i < state->dirty_count; i++) {
+        uint tile = state->dirty_tiles[i];
+        uint x    = (tile % tiles_x) * DIRTY_TILE_SIZE;
+        uint y    = (tile / tiles_x) * DIRTY_TILE_SIZE;
+        size_t offset = y * tex.width + x;
+
+        /* with a pbo bound the pointer is an offset into it */
+        const void* pixels = pbo ? (const void*) (offset * sizeof(color_t)) : (const void*) (tex.rgb + offset);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, min(DIRTY_TILE_SIZE, tex.width - x), min(DIRTY_TILE_SIZE, tex.height - y), GL_RGBA, GL_FLOAT, pixels);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    if (pbo && state->dirty_count) { upload_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0); }
+
+    if (verify_uploads) {
+        static color_t* readback = NULL;
+        size_t size = tex.width * tex.height * sizeof(color_t);
+        readback = realloc(readback, size);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, readback);
+        if (memcmp(readback, tex.rgb, size) != 0) { printf("Uploaded texture differs from the generated one\n"); }
+    }
+
     return 1;
 }
 
@@ -146,9 +181,14 @@ int platform_load_code()
     }
 
     alloc_texture     = (int (*)(state_t*)) SDL_LoadFunction(dll_handle, "alloc_texture");
-    generate_textures = (int (*)(state_t*,float)) SDL_LoadFunction(dll_handle, "generate_textures");
+    generate_textures = (int (*)(state_t*,float,float)) SDL_LoadFunction(dll_handle, "generate_textures");
+    bake_textures     = (int (*)(state_t*,int)) SDL_LoadFunction(dll_handle, "bake_textures");
     if (!alloc_texture)     { printf("Error finding function\n"); return 0; }
     if (!generate_textures) { printf("Error finding function\n"); return 0; }
+    if (!bake_textures)     { printf("Error finding function\n"); return 0; }
+
+    /* cancel the atlas that was in progress, the new code starts over */
+    if (state) { state->next_tile = 0; }
 
     return 1;
 }
@@ -156,6 +196,14 @@ int platform_load_code()
 void GLAPIENTRY gl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam) {fprintf(stderr, "%s\n", message);}
 int main(int argc, char* args[])
 {
+    int use_pbo     = 1;
+    int bake_frames = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(args[i], "--no-pbo") == 0) { use_pbo = 0; }
+        if (strcmp(args[i], "--bake") == 0 && i + 1 < argc) { bake_frames = atoi(args[++i]); } // e.g. --bake 60, prints how many tiles are unique
+        if (strcmp(args[i], "--verify") == 0) { verify_uploads = 1; }
+    }
+
     /* sdl initialization boilerplate */
     {
         if (SDL_Init(SDL_INIT_VIDEO) < 0) { fprintf(stderr, "Failed to initialize SDL: %s\n", SDL_GetError()); return -1; }
@@ -178,6 +226,7 @@ int main(int argc, char* args[])
 
     state = malloc(sizeof(state_t));
     alloc_texture(state);
+    if (bake_frames > 0) { bake_textures(state, bake_frames); }
 
     /* init glew, vao, vbo, texture & upload texture */
     {
@@ -217,9 +266,33 @@ int main(int argc, char* args[])
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
+        /* allocate storage once, upload_textures() only updates the tiles that changed */
+        glTexImage2D(GL_TEXTURE_2D, 0, tex_mode, state->texer.atlas_width, state->texer.atlas_height, 0, GL_RGBA, GL_FLOAT, NULL);
+
+        /* let the generator write straight into a persistently mapped pixel buffer. NOTE: blending reads the
+         * texture back, so the buffer is kept in client memory and mapped for reading too */
+        if (use_pbo && GLEW_ARB_buffer_storage) {
+            GLsizeiptr size   = state->texer.atlas_width * state->texer.atlas_height * sizeof(color_t);
+            GLbitfield access = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glGenBuffers(1, &pbo);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, access | GL_CLIENT_STORAGE_BIT);
+            color_t* mapped = (color_t*) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, access);
+            if (mapped) {
+                memcpy(mapped, state->texer.tex.rgb, size);
+                free(state->texer.tex.rgb);
+                state->texer.tex.rgb = mapped;
+            } else {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                glDeleteBuffers(1, &pbo);
+                pbo = 0;
+            }
+        }
+        printf("Uploading %s\n", pbo ? "from a persistently mapped buffer" : "from client memory");
+
         /* enable blending for transparency */
         glEnable(GL_BLEND);
-        glBlendFunc(GL_ONE, GL_SRC_ALPHA);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // textures are premultiplied
     }
 
     assert(glGetError() == GL_NO_ERROR);
@@ -325,8 +398,13 @@ int main(int argc, char* args[])
 
         /* generate textures again */
         if (!paused) {
-            generate_textures(state,dt);
-            upload_textures(state);
+            /* don't generate into the pbo while the gpu might still be reading the last upload */
+            if (upload_fence) {
+                glClientWaitSync(upload_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+                glDeleteSync(upload_fence);
+                upload_fence = NULL;
+            }
+            if (generate_textures(state, dt, GENERATE_BUDGET)) { upload_textures(state); }
             ///* free allocated textures */
             //for (int i = 0; i < TEXTURE_COUNT; i ++)
             //{
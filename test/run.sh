@@ -1,3 +1,5 @@
 #!/bin/bash
 
-MESA_GLSL_VERSION_OVERRIDE=430 MESA_GL_VERSION_OVERRIDE=4.3FC ./main
+# e.g. LIBGL_ALWAYS_SOFTWARE=1 ./run.sh --verify to check partial uploads on mesa's software rasterizer
+# ./run.sh --bake 60 to bake one period of the animations and print how many tiles dedupe
+MESA_GLSL_VERSION_OVERRIDE=430 MESA_GL_VERSION_OVERRIDE=4.3FC ./main "$@"
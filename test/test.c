@@ -6,6 +6,7 @@
 #include <math.h>   // for sinf
 #include <time.h>   // for seeding srand()
 #include <stdlib.h> // for rand()
+#include <stdatomic.h> // for next_tile
 
 #include <stdio.h>
 
@@ -28,7 +29,13 @@ static color_t BROWN   = {0.6, 0.3, 0, 1};
 static color_t VIOLET  = {0.8,0,0.4,1};
 
 __attribute__((visibility("default"))) int alloc_texture(state_t* state) {
-    state->texer = texture(TEXTURE_ATLAS_WIDTH, TEXTURE_ATLAS_HEIGHT);
+    state->texer = texture_flags(texture(TEXTURE_ATLAS_WIDTH, TEXTURE_ATLAS_HEIGHT), TEXER_FLAG_FLIP);
+
+    uint tile_count    = ((TEXTURE_ATLAS_WIDTH + DIRTY_TILE_SIZE - 1) / DIRTY_TILE_SIZE) * ((TEXTURE_ATLAS_HEIGHT + DIRTY_TILE_SIZE - 1) / DIRTY_TILE_SIZE);
+    state->tile_hashes = calloc(tile_count, sizeof(unsigned long long));
+    state->dirty_tiles = malloc(tile_count * sizeof(uint));
+    state->dirty_count = 0;
+    state->next_tile   = 0;
     return 1;
 }
 
@@ -36,120 +43,139 @@ __attribute__((visibility("default"))) int alloc_texture(state_t* state) {
 static float timer = 0;
 static uint random_seed_per_sec   = 0;
 static uint random_seed_per_frame = 0;
+static uint preview_level = 3; // the first frames after (re)loading show coarser levels, see texer_level()
+
+/* the atlas is generated tile by tile, so generation can stop once the frame's time budget is used up */
+#define GENERATE_TILE_SIZE 16
+#define GENERATE_TILES_X   ((TEXTURE_ATLAS_WIDTH  + GENERATE_TILE_SIZE - 1) / GENERATE_TILE_SIZE)
+#define GENERATE_TILES     (GENERATE_TILES_X * ((TEXTURE_ATLAS_HEIGHT + GENERATE_TILE_SIZE - 1) / GENERATE_TILE_SIZE))
+static double seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-typedef struct thread_t { pthread_t id; int nr; int count; texture_t* tex; texer_t builder; } thread_t;
+typedef struct thread_t { pthread_t id; texture_t* tex; texer_t builder; float time; uint seed; uint level; atomic_uint* next_tile; double deadline; } thread_t;
 void* tex_build(void* args)
 {
-    float zero_to_one = (sinf(timer) + 1)/2;
+    thread_t* t = (thread_t*) args;
+
+    float zero_to_one = (sinf(t->time) + 1)/2;
     color_t _COLOR  = {zero_to_one,0,0.4,1};
 
-    thread_t* t = (thread_t*) args;
-    texer_threaded(*t->tex, t->builder, t->nr, t->count) {
-        color(NONE);
+    /* NOTE: every tile that was taken gets finished, so all tiles before next_tile are done */
+    while (seconds() < t->deadline) {
+        uint tile = atomic_fetch_add(t->next_tile, 1);
+        if (tile >= GENERATE_TILES) { break; }
+        int tile_x = (tile % GENERATE_TILES_X) * GENERATE_TILE_SIZE;
+        int tile_y = (tile / GENERATE_TILES_X) * GENERATE_TILE_SIZE;
 
-        /* creeper face */
-        texer_rect(0,0,32,32)   {
-            color(GREEN);
-            seed((int)rand());
-            //seed(random_seed_per_frame);
-            noise(1.0);
-            texer_rect(4,8,8,8) {
-                color(BLACK);
-                texer_rect(2,2,4,4) {
-                    color(_COLOR);
+        texer_tile(*t->tex, t->builder, t->level, tile_x, tile_y, GENERATE_TILE_SIZE, GENERATE_TILE_SIZE) {
+            color(NONE);
+
+            /* creeper face */
+            texer_rect(0,0,32,32)   {
+                color(GREEN);
+                seed(t->seed); // NOTE: not rand(), which is neither thread-safe nor the same for every pixel
+                noise(1.0);
+                texer_rect(4,8,8,8) {
+                    color(BLACK);
+                    texer_rect(2,2,4,4) {
+                        color(_COLOR);
+                    }
                 }
-            }
-            texer_rect(20,8,8,8) {
-                color(BLACK);
-                texer_rect(2,2,4,4) {
-                    color(_COLOR);
+                texer_rect(20,8,8,8) {
+                    color(BLACK);
+                    texer_rect(2,2,4,4) {
+                        color(_COLOR);
+                    }
                 }
+                texer_rect(12,16,8,16) { color(BLACK); }
+                texer_rect(8,20,16,16) { color(BLACK); }
+                texer_rect(12,(int) lerp(zero_to_one, 28, 33), 8,16)  { color(GREEN); noise(1.0); } // NOTE: not properly cut off
             }
-            texer_rect(12,16,8,16) { color(BLACK); }
-            texer_rect(8,20,16,16) { color(BLACK); }
-            texer_rect(12,(int) lerp(zero_to_one, 28, 33), 8,16)  { color(GREEN); noise(1.0); } // NOTE: not properly cut off
-        }
 
-        /* sliding door */
-        texer_rect(32,0,32,32)  {
-            color(BLACK);
-            texer_rectcut_left((int) lerp(zero_to_one, 18, 0))
-            {
-                color(GRAY);
-                noise(0.3);
-                texer_rectcut_right(3) {
-                  color((color_t){0.2,0.3,0.5,1});
+            /* sliding door */
+            texer_rect(32,0,32,32)  {
+                color(BLACK);
+                texer_rectcut_left((int) lerp(zero_to_one, 18, 0))
+                {
+                    color(GRAY);
+                    noise(0.3);
+                    texer_rectcut_right(3) {
+                      color((color_t){0.2,0.3,0.5,1});
+                    }
                 }
-            }
-            texer_rectcut_right((int) lerp(zero_to_one, 18, 0)) {
-                color(GRAY);
-                noise(0.3);
-                texer_rectcut_left(3) {
-                  color((color_t){0.2,0.5,0.5,1});
+                texer_rectcut_right((int) lerp(zero_to_one, 18, 0)) {
+                    color(GRAY);
+                    noise(0.3);
+                    texer_rectcut_left(3) {
+                      color((color_t){0.2,0.5,0.5,1});
+                    }
                 }
             }
-        }
 
-        /* pong animation */
-        texer_rect(64,0,32,32)  {
-            color(GRAY);
-            noise(0.1);
+            /* pong animation */
+            texer_rect(64,0,32,32)  {
+                color(GRAY);
+                noise(0.1);
 
-            texer_rect(lerp(zero_to_one,2,28),lerp(zero_to_one,3,28),3,3) { color(WHITE); }
-            texer_rectcut_left(2)  {
-                texer_rect(0, lerp(zero_to_one,0,25),2,8) color(WHITE);
-            }
-            texer_rectcut_right(2) {
-                texer_rect(0, lerp(zero_to_one,0,25),2,8) color(WHITE);
+                texer_rect(lerp(zero_to_one,2,28),lerp(zero_to_one,3,28),3,3) { color(WHITE); }
+                texer_rectcut_left(2)  {
+                    texer_rect(0, lerp(zero_to_one,0,25),2,8) color(WHITE);
+                }
+                texer_rectcut_right(2) {
+                    texer_rect(0, lerp(zero_to_one,0,25),2,8) color(WHITE);
+                }
             }
-        }
 
-        /* zoom-in */
-        texer_rect(0,32,32,32)  {
-            color(BLUE);
-            unsigned int t_ = lerp(zero_to_one,1,20);
-            outline(RED, t_) {
-                outline(GRAY,t_) {
-                    outline(YELLOW,t_) {
-                        outline(CYAN,t_) {
-                            outline(GREEN,t_) {
+            /* zoom-in */
+            texer_rect(0,32,32,32)  {
+                color(BLUE);
+                unsigned int t_ = lerp(zero_to_one,1,20);
+                outline(RED, t_) {
+                    outline(GRAY,t_) {
+                        outline(YELLOW,t_) {
+                            outline(CYAN,t_) {
+                                outline(GREEN,t_) {
+                                }
                             }
                         }
                     }
                 }
             }
-        }
 
-        /* testing clamping */
-        texer_rect(32,32,32,32) {
-            color(BLACK);
-            texer_rect(0, (int) lerp(zero_to_one, 0, 33),32,32) {
-                color(ORANGE);
-                texer_rectcut_left(10)  { color(YELLOW); }
-                texer_rectcut_right(10) { color(YELLOW); }
-                texer_rectcut_top(5)    { color(ORANGE); }
+            /* testing clamping */
+            texer_rect(32,32,32,32) {
+                color(BLACK);
+                texer_rect(0, (int) lerp(zero_to_one, 0, 33),32,32) {
+                    color(ORANGE);
+                    texer_rectcut_left(10)  { color(YELLOW); }
+                    texer_rectcut_right(10) { color(YELLOW); }
+                    texer_rectcut_top(5)    { color(ORANGE); }
+                }
             }
-        }
 
-        /* art painting (TODO turn into shattered mirror) */
-        texer_rect(64,32,32,32) {
-            color(GRAY);
-            outline(BROWN, 2) {
-                seed(1);
-                voronoi(10);
+            /* art painting (TODO turn into shattered mirror) */
+            texer_rect(64,32,32,32) {
+                color(GRAY);
+                outline(BROWN, 2) {
+                    seed(1);
+                    voronoi(10);
+                }
             }
-        }
 
-        texer_rect(0,64,32,32) {
-            color(BLACK);
-        }
+            texer_rect(0,64,32,32) {
+                color(BLACK);
+            }
 
-        /* using for loops for generating */
-        for (int i = 0; i < 3; i++) {
-            texer_rect(32 * i,64,32,32) {
-                switch (i) {
-                    case 1: { color(MAGENTA); } break;
-                    case 2: { color(CYAN);    } break;
+            /* using for loops for generating */
+            for (int i = 0; i < 3; i++) {
+                texer_rect(32 * i,64,32,32) {
+                    switch (i) {
+                        case 1: { color(MAGENTA); } break;
+                        case 2: { color(CYAN);    } break;
+                    }
                 }
             }
         }
@@ -159,15 +185,25 @@ void* tex_build(void* args)
 }
 
 #include <pthread.h>
-__attribute__((visibility("default"))) int generate_textures(state_t* state, float dt) {
+#define NUM_THREADS 8
+/* generates tiles of the atlas until budget seconds have passed, the next call continues where this one
+ * stopped (state->next_tile). returns 1 once the atlas is complete, the next call then starts a new one */
+__attribute__((visibility("default"))) int generate_textures(state_t* state, float dt, float budget) {
+    double deadline = seconds() + budget;
+
     /* animation test */
     timer += dt;
 
-    /* reset srand() */
+    /* every tile of an atlas is generated for the same point in time */
+    if (state->next_tile == 0) {
+        state->frame_time = timer;
+
+        /* reset srand() */
 
-    /* reseeds every frame */
-    srand(time(0) + random_seed_per_frame);
-    random_seed_per_frame = (uint) rand();
+        /* reseeds every atlas */
+        srand(time(0) + random_seed_per_frame);
+        random_seed_per_frame = (uint) rand();
+    }
 
     /* reseed every second */
     //srand(time(0));
@@ -175,13 +211,17 @@ __attribute__((visibility("default"))) int generate_textures(state_t* state, flo
 
     texture_t atlas = {0};
 
-    #define NUM_THREADS 8
+    atomic_uint next_tile = state->next_tile;
+
     thread_t threads[NUM_THREADS];
     for (int i = 0; i < NUM_THREADS; i++) {
-        threads[i].count = NUM_THREADS;
-        threads[i].nr       = i;
-        threads[i].tex      = &atlas;
-        threads[i].builder  = state->texer;
+        threads[i].tex       = &atlas;
+        threads[i].builder   = state->texer;
+        threads[i].time      = state->frame_time;
+        threads[i].seed      = random_seed_per_frame;
+        threads[i].level     = preview_level;
+        threads[i].next_tile = &next_tile;
+        threads[i].deadline  = deadline;
         pthread_create(&threads[i].id, NULL, tex_build, (void*) &threads[i]);
     }
 
@@ -272,7 +312,62 @@ __attribute__((visibility("default"))) int generate_textures(state_t* state, flo
         pthread_join(threads[i].id, NULL);
     }
 
+    /* NOTE: threads take one more tile than there is before they stop */
+    state->next_tile = min(atomic_load(&next_tile), GENERATE_TILES);
+    if (state->next_tile < GENERATE_TILES) { return 0; }
+    state->next_tile = 0;
+
+    if (preview_level > 0) { preview_level--; }
+
     state->tex[0] = atlas;
+    state->dirty_count = texture_dirty_tiles(atlas, DIRTY_TILE_SIZE, DIRTY_TILE_SIZE, state->tile_hashes, state->dirty_tiles);
+
+    return 1;
+}
+
+/* bakes one period of the animations into an array texture, frames are distributed across threads. every frame
+ * uses the same seed, so tiles that don't animate come out identical and get deduplicated */
+#define BAKE_SEED 1
+typedef struct bake_t { pthread_t id; int nr; int count; int frame_count; texer_t frames; } bake_t;
+void* bake_frames(void* args)
+{
+    bake_t* b = (bake_t*) args;
+    for (int frame = b->nr; frame < b->frame_count; frame += b->count) {
+        texture_t layer;
+        atomic_uint next_tile = 0;
+        thread_t t = {0};
+        t.tex       = &layer;
+        t.builder   = texture_layer(b->frames, frame);
+        t.time      = (2 * M_PI * frame) / b->frame_count;
+        t.seed      = BAKE_SEED;
+        t.next_tile = &next_tile;
+        t.deadline  = INFINITY; // all tiles
+        tex_build(&t);
+    }
+    return NULL;
+}
+
+__attribute__((visibility("default"))) int bake_textures(state_t* state, int frame_count) {
+    texer_t frames = texture_flags(texture_array(TEXTURE_ATLAS_WIDTH, TEXTURE_ATLAS_HEIGHT, frame_count), TEXER_FLAG_FLIP);
+
+    bake_t threads[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; i++) {
+        threads[i].nr          = i;
+        threads[i].count       = NUM_THREADS;
+        threads[i].frame_count = frame_count;
+        threads[i].frames      = frames;
+        pthread_create(&threads[i].id, NULL, bake_frames, (void*) &threads[i]);
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_join(threads[i].id, NULL);
+    }
+
+    /* every tile of the atlas is 32x32 */
+    uint tile_count     = (TEXTURE_ATLAS_WIDTH / 32) * (TEXTURE_ATLAS_HEIGHT / 32);
+    state->frames       = frames.tex;
+    state->frame_tiles  = malloc(frame_count * tile_count * sizeof(uint));
+    uint unique = texture_dedupe_tiles(state->frames, 32, 32, state->frame_tiles);
+    printf("Baked %i frames, %u of %u tiles are unique\n", frame_count, unique, frame_count * tile_count);
 
     return 1;
 }
@@ -56,6 +56,7 @@
 */
 
 #include <stddef.h>
+#include <math.h>   // for sqrtf
 
 #ifndef RUN_ON_COMPUTE_SHADER
 /* TODO use these */
@@ -66,7 +67,142 @@ typedef struct texture_t texture_t;
 
 // NOTE RGBA vs BGRA layout could be set with a macro
 struct color_t       { float r; float g; float b; float a;        };
-struct texture_t     { uint width; uint height; color_t* rgb; };
+struct texture_t     { uint width; uint height; color_t* rgb; int flags; /* TEXER_FLAG_* the texture was built with */ uint layers; };
+
+/* orientation flags, set per texture with texture_flags() */
+enum {
+      TEXER_FLAG_NONE   = 0,
+      TEXER_FLAG_FLIP   = (1 << 0), /* store rows bottom-up (what OpenGL expects) */
+      TEXER_FLAG_MIRROR = (1 << 1), /* store columns right-to-left */
+};
+
+/* blend modes, set with blend() */
+enum {
+      TEXER_BLEND_ALPHA,
+      TEXER_BLEND_ADD,
+      TEXER_BLEND_MULTIPLY,
+      TEXER_BLEND_SCREEN,
+      TEXER_BLEND_OVERLAY,
+      TEXER_BLEND_COUNT,
+};
+
+/* filters for texture_resize() */
+enum {
+      TEXER_FILTER_BILINEAR,
+      TEXER_FILTER_LANCZOS, /* lanczos3, sharper but rings on hard edges */
+};
+
+/* block compression formats for texture_compress() */
+enum {
+      TEXER_BC1, /* 8 bytes per 4x4 block, color only */
+      TEXER_BC3, /* 16 bytes per 4x4 block, interpolated alpha followed by BC1 color */
+};
+
+/* image formats for texture_encode() */
+enum {
+      TEXER_IMAGE_QOI,
+      TEXER_IMAGE_PNG,
+};
+
+/* additional output targets, allocated with texture_targets() */
+enum {
+      TEXER_TARGET_HEIGHT    = (1 << 0),
+      TEXER_TARGET_ROUGHNESS = (1 << 1),
+      TEXER_TARGET_FIXED16   = (1 << 2), /* composite into 16-bit fixed point instead of tex.rgb (which gets freed), read it with texture_rgba8() */
+};
+
+/* arbitrary shaped 8-bit coverage mask, see texture_mask() and texer_masked().
+ * coverage is stored in 8x8 tiles (64 contiguous bytes per tile) and every tile
+ * is flagged as empty, full or partial so only partial tiles need to be sampled.
+ * NOTE: the flags don't let the traversal skip empty tiles, the builder still runs for
+ * every pixel and texer_masked() culls them one by one after reading the tile's flag */
+enum {
+      TEXER_TILE_EMPTY,
+      TEXER_TILE_FULL,
+      TEXER_TILE_PARTIAL,
+};
+#define TEXER_TILE_SIZE 8
+typedef struct texer_mask_t {
+    uint width;
+    uint height;
+    uint tiles_x;
+    unsigned char* tiles;    /* TEXER_TILE_* per tile, row by row */
+    unsigned char* coverage; /* 0 (outside) to 255 (inside) */
+} texer_mask_t;
+
+/* exact euclidean distance to the edge of a mask, computed once with texture_distance() */
+typedef struct texer_field_t {
+    uint width;      /* size of the mask plus padding on every side, so that ops can reach past the shape */
+    uint height;
+    uint padding;
+    float* distance; /* signed distance in pixels, negative inside, row by row */
+} texer_field_t;
+
+/* glyphs of the builtin font baked once at a fixed size by texer_font(), all glyphs side by side in one
+ * mask so that text() only has to look up coverage instead of rasterizing per pixel */
+typedef struct texer_font_t {
+    uint glyph_w; /* advance from one glyph to the next */
+    uint glyph_h;
+    texer_mask_t atlas;
+} texer_font_t;
+
+/* a string measured once by texer_text(), so that text() can reject pixels past its end without walking it */
+typedef struct texer_text_t {
+    texer_font_t font;
+    const char* str; /* not copied, needs to outlive the run */
+    uint length;
+} texer_text_t;
+
+/* encoded rows of one thread, see texture_encode() */
+typedef struct texer_chunk_t {
+    unsigned char* data;
+    size_t size;
+    size_t raw_size; /* PNG: bytes before compression */
+    uint checksum;   /* PNG: adler-32 of those bytes */
+} texer_chunk_t;
+
+/* line segments binned into a grid of cells, built once with texer_lines() or texer_polyline(), so
+ * that lines() only has to look at the few segments near a pixel instead of all of them */
+typedef struct texer_lines_t {
+    float* segments;   /* x0,y0,x1,y1 per segment, relative to the rect that is drawn into */
+    float  thickness;
+    int    x, y;       /* top left of the grid */
+    uint   cells_x, cells_y;
+    uint*  cell_start; /* segments of cell i are cell_segments[cell_start[i]] to cell_segments[cell_start[i+1]-1] */
+    uint*  cell_segments;
+} texer_lines_t;
+#define TEXER_LINES_CELL_SIZE 8
+
+/* affine map from content to rect coordinates: x = a*u + b*v + tx, y = c*u + d*v + ty.
+ * create with texer_affine() or texer_rotation(), which also precompute the inverse */
+typedef struct texer_affine_t {
+    float a, b, c, d, tx, ty;
+    float inverse[6]; /* same layout */
+} texer_affine_t;
+
+/* builders recorded as bytecode with texer_record(), e.g. to cache them or to ship them to another process.
+ * every instruction is an opcode byte followed by its operands, each a 32-bit little-endian int or float */
+enum {
+      TEXER_OP_PUSH_RECT, /* x, y, w, h: absolute rect, already clipped to the enclosing one */
+      TEXER_OP_POP,
+      TEXER_OP_COLOR,     /* r, g, b, a */
+      TEXER_OP_NOISE,     /* intensity */
+      TEXER_OP_OUTLINE,   /* r, g, b, a, thickness */
+      TEXER_OP_VORONOI,   /* seed points */
+      TEXER_OP_SEED,      /* seed */
+      TEXER_OP_BLEND,     /* mode */
+      TEXER_OP_HEIGHT,    /* height */
+      TEXER_OP_ROUGHNESS, /* roughness */
+      TEXER_OP_COUNT,
+};
+#define TEXER_PROGRAM_MAX_DEPTH 64 /* nested rects */
+typedef struct texer_program_t {
+    unsigned char* code; /* malloc'd by texer_record(), or any bytes that hold a program */
+    size_t size;
+    size_t capacity;
+    color_t scratch;     /* the single pixel that writes land on while recording */
+    int unrecordable;    /* set by texer_record() if the builder used an op or scope that can't be recorded */
+} texer_program_t;
 
 /* used internally */
 enum {
@@ -77,7 +213,7 @@ enum {
 };
 typedef struct clipping_sdf_t {
     uint type;
-    int x,y,r,w,h;
+    int x,y,r,w,h; /* bounding box in atlas coordinates, r is the radius of the (rounded) corners */
 } clipping_sdf_t;
 typedef struct texer_t {
     texture_t tex;
@@ -86,35 +222,231 @@ typedef struct texer_t {
     uint atlas_width;
     uint atlas_height;
 
-    // int flags; // TODO bitfield containing e.g. TEX_BUILD_{FLIP,MIRROR,BLEND_ALPHA}
+    /* derived from tex.flags by texture_flags(), so that get_index never has to branch:
+     * index = origin + pixel_y * pitch + pixel_x * step (flipping is a negative pitch) */
+    int origin;
+    int pitch;
+    int step;
 
     uint seed; /* random seed that will be used by noise, voronoi, etc. */
 
+    /* layer of an array texture that is currently written to, see texer_variants() */
+    uint layer;
+    uint variant_seed; /* mixed into every seed() so each variant gets its own randomness */
+
     struct {
         int x, y;
         int w, h;
     } mask; // TODO rename to clipping_region
 
-    clipping_sdf_t sdf;
+    /* product of the coverage of all shaped scopes (circles, masks, ...) at the current pixel.
+     * nested scopes multiply into it and restore it on exit, so it acts as a mask stack */
+    float coverage;
+
+    /* material targets, laid out like tex.rgb. NULL if not allocated */
+    struct {
+        float* height;
+        float* roughness;
+        unsigned short* fixed; /* rgba, premultiplied with TEXER_FIXED_ONE as 1.0 */
+    } targets;
+
+    /* written into the targets by every op that colors a pixel, set with height() and roughness() */
+    struct {
+        float height;
+        float roughness;
+    } material;
+
+    /* how ops combine their color with the texture, looked up once by blend() instead of switching per pixel */
+    color_t (*blend)(color_t src, color_t dst);
+
+    texer_program_t* program; /* set while recording, ops append to it instead of drawing */
 
     /* used in for-loop macros */
     int i;
+    struct { int x, y; } transformed; /* content coordinates of the current pixel inside of texer_transform(), the pixel itself in the old builder */
 } texer_t;
 
-/* NOTE: turn into flags that can be set by user */
-#define TEXER_FLAG_FLIP 1
-
 /*
  * api
  */
-/* building api (allocating) */
+/* building api (allocating). built textures hold premultiplied alpha, i.e. color({1,0,0,0.5}) on a clear
+ * texture stores {0.5,0,0,0.5}, and so does every texture that is passed to blit() */
 texer_t texture(int w, int h);
+texer_t texture_array(int w, int h, int layers); /* layers are stored back to back, layer i starts at rgb[i*w*h] */
+texer_t texture_flags(texer_t builder, int flags); /* e.g. texture_flags(texture(w,h), TEXER_FLAG_FLIP|TEXER_FLAG_MIRROR) */
+texer_t texture_layer(texer_t builder, uint layer); /* builder that writes into the given layer of an array texture */
+texer_t texture_targets(texer_t builder, int targets); /* e.g. texture_targets(texture(w,h), TEXER_TARGET_HEIGHT), FIXED16 leaves no tex.rgb for texture_t consumers */
+texer_mask_t texture_mask(texture_t tex); /* coverage from the brightness of the texture, i.e. draw the shape in white */
+void texture_blit(texture_t dst, texture_t src, int x, int y); /* plain copy of src into dst at x,y, no blending or clipping other than to dst */
+
+/* decode rows of characters through a palette of 256 colors (one per character) into a texture, e.g.
+ *   #define STAMP_COLORS(X) X('#', RED) X('-', GREEN)
+ *   const color_t palette[256] = { STAMP_COLORS(TEXER_PALETTE_ENTRY) }; // unlisted characters are transparent
+ *   texture_t stamp = texture_from_string(palette, "#--#",
+ *                                                  "-##-");
+ * all rows need to be of the same length, palette colors are straight and get premultiplied */
+#define TEXER_PALETTE_ENTRY(character, color) [(unsigned char) (character)] = color,
+#define texture_from_string(palette, ...) _texture_from_string(palette, __VA_ARGS__, (const char*) NULL)
+texture_t _texture_from_string(const color_t* palette, const char* first, ...);
+
+texer_field_t texture_distance(texer_mask_t mask, uint padding); /* inside is where coverage is at least half */
+texture_t texture_sdf(texer_field_t field, float spread); /* distance mapped to [0,1] with 0.5 on the edge, spread pixels to each side */
+texer_font_t texer_font(uint size); /* size is the height of a capital letter in pixels */
+texer_text_t texer_text(texer_font_t font, const char* str); /* str in the given font, ready for text() */
+texer_lines_t texer_lines(const float* segments, uint count, float thickness); /* count segments of x0,y0,x1,y1 */
+texer_lines_t texer_polyline(const float* points, uint count, float thickness); /* count points of x,y, connected in order */
+
+/* resize src into dst (allocated by the caller, e.g. texture(w,h).tex) with a separable two-pass filter.
+ * every thread filters a contiguous band of dst rows and only the src rows that band needs */
+void texture_resize(texture_t dst, texture_t src, int filter, uint thread_id, uint thread_count);
+
+/* blur the rect x,y,w,h of src into the same rect of dst with sliding window sums, so the cost per pixel
+ * does not depend on the radius. the gaussian is approximated by three box blurs. every thread blurs a
+ * contiguous run of fixed blocks of rows, so the result is the same for any thread count. dst must not be
+ * src unless thread_count is 1 */
+void texture_box_blur(texture_t dst, texture_t src, int x, int y, int w, int h, int radius, uint thread_id, uint thread_count);
+void texture_gaussian_blur(texture_t dst, texture_t src, int x, int y, int w, int h, float sigma, uint thread_id, uint thread_count);
+
+/* derive a normal map from the height target with a sobel filter. the builder needs to be made with
+ * TEXER_TARGET_HEIGHT (nothing is written otherwise), normals needs to be allocated like the builder's
+ * texture. computed in storage order, i.e. TEXER_FLAG_FLIP gives OpenGL's +Y up convention */
+void texture_normals(texer_t builder, texture_t normals, float strength, uint thread_id, uint thread_count);
+
+/* 8-bit RGBA of the TEXER_TARGET_FIXED16 target in storage order (ready for glTexImage2D with GL_UNSIGNED_BYTE),
+ * rgba needs 4 bytes per pixel of every layer. every thread converts every thread_count-th row */
+void texture_rgba8(texer_t builder, unsigned char* rgba, uint thread_id, uint thread_count);
+
+/* animation baking: with one frame per layer, table[frame * tile_count + tile] receives the layer
+ * that holds the pixels of that tile, i.e. an earlier frame if the tile did not change since then.
+ * tiles are numbered row by row from the top left. returns the number of tiles that are unique. */
+uint texture_dedupe_tiles(texture_t frames, uint tile_w, uint tile_h, uint* table);
+
+/* compress into 4x4 blocks in storage order, i.e. ready for glCompressedTexImage2D for TEXER_FLAG_FLIP.
+ * blocks needs texture_compressed_size() bytes, layers follow each other. every thread encodes every
+ * thread_count-th row of blocks. partial blocks at the edges repeat the last row/column */
+size_t texture_compressed_size(texture_t tex, int format);
+void texture_compress(texture_t tex, int format, unsigned char* blocks, uint thread_id, uint thread_count);
+
+/* image export as 8-bit RGBA, layers are stacked vertically. every thread encodes a contiguous band of rows
+ * straight from the texture into its own chunk, so no 8-bit copy of the whole image is made. texture_join()
+ * then puts the chunks of all threads (in thread order) between header and footer and frees them, e.g.
+ *   chunks[id] = texture_encode(tex, TEXER_IMAGE_PNG, id, count); // on every thread
+ *   unsigned char* file = texture_join(tex, TEXER_IMAGE_PNG, chunks, count, &size); */
+texer_chunk_t texture_encode(texture_t tex, int format, uint thread_id, uint thread_count);
+unsigned char* texture_join(texture_t tex, int format, texer_chunk_t* chunks, uint count, size_t* size);
+
+/* pipeline of stages connected by bounded queues, e.g. generate -> compress -> encode -> write. every stage
+ * turns an item into the item for the next stage (or NULL to drop it). the caller's threads run
+ * texer_pipeline_work(), which always prefers later stages so that finished work leaves first. at most
+ * capacity items wait in front of every stage, so memory stays bounded however many items are pushed.
+ * NOTE: opt-in with #define TEXER_PIPELINE, it needs C11 atomics and sched_yield() which the rest doesn't */
+#ifdef TEXER_PIPELINE
+typedef struct texer_pipeline_t texer_pipeline_t;
+typedef void* (*texer_stage_t)(void* item, void* user);
+#define TEXER_PIPELINE_MAX_STAGES 8
+texer_pipeline_t* texer_pipeline(uint capacity);
+void texer_pipeline_stage(texer_pipeline_t* pipeline, texer_stage_t stage, void* user); /* before the first push */
+void texer_pipeline_push(texer_pipeline_t* pipeline, void* item); /* helps out with queued work while the first queue is full */
+void texer_pipeline_close(texer_pipeline_t* pipeline); /* no more items will be pushed */
+void texer_pipeline_work(texer_pipeline_t* pipeline);  /* returns once the pipeline is closed and every item went through */
+void texer_pipeline_free(texer_pipeline_t* pipeline);
+#endif
+
+/* partial uploads: hashes keeps one hash per tile (and layer) between calls and must be zeroed before the
+ * first one, dirty receives the tiles that changed since the last call. tiles are numbered row by row in
+ * storage order, i.e. from the bottom left for TEXER_FLAG_FLIP (what glTexSubImage2D expects), and continue
+ * into the next layer. returns the number of dirty tiles */
+uint texture_dirty_tiles(texture_t tex, uint tile_w, uint tile_h, unsigned long long* hashes, uint* dirty);
+
+/* virtual texture that is far too big to generate as a whole. the builder is a function that gets called
+ * per pixel with the usual temp, pixel_x and pixel_y, so the drawing api works as is, e.g.
+ *   texer_t world(texer_t temp, int pixel_x, int pixel_y, void* user) { color(GREEN); noise(0.2); return temp; }
+ *   texer_virtual_t vt = texer_virtual(1 << 20, 1 << 20, 128, 64, world, NULL);
+ *   texture_t page = texer_sample_tile(&vt, x, y, lod);
+ * pages are generated on first access into a cache of cache_pages pages that evicts the least recently
+ * used one. only cached pages are kept in the page table (a hash map sized to the cache), so memory only
+ * depends on what is being looked at. a page of level lod covers page_size << lod
+ * pixels of the virtual texture per side and point samples them at the center of every block */
+typedef texer_t (*texer_page_builder_t)(texer_t temp, int pixel_x, int pixel_y, void* user);
+#define TEXER_PAGE_NONE 0xFFFFFFFFu
+#define TEXER_VIRTUAL_MAX_LEVELS 32
+typedef struct texer_page_slot_t {
+    unsigned long long page; /* level_start[lod] + y * level_pages_x[lod] + x */
+    uint layer;              /* TEXER_PAGE_NONE for an empty slot */
+} texer_page_slot_t;
+typedef struct texer_virtual_t {
+    uint width;      /* of the whole virtual texture at lod 0 */
+    uint height;
+    uint page_size;
+    uint levels;     /* down to the level that fits into a single page */
+    texer_page_builder_t build;
+    void* user;
+
+    texer_t cache;   /* array texture with one page per layer */
+    texer_page_slot_t* page_table;              /* cached pages by page number, open addressing with linear probing */
+    uint  page_table_mask;                      /* slot count - 1, at least twice cache_pages so probes stay short */
+    unsigned long long level_start[TEXER_VIRTUAL_MAX_LEVELS]; /* first page number of every level (row by row) */
+    uint  level_pages_x[TEXER_VIRTUAL_MAX_LEVELS];
+    uint  level_pages_y[TEXER_VIRTUAL_MAX_LEVELS];
+    unsigned long long* layer_page;             /* page number held by every layer */
+    unsigned long long* last_used;              /* per layer, 0 for a layer that holds no page yet */
+    unsigned long long  clock;
+} texer_virtual_t;
+texer_virtual_t texer_virtual(uint width, uint height, uint page_size, uint cache_pages, texer_page_builder_t build, void* user);
+texture_t texer_sample_tile(texer_virtual_t* vt, uint x, uint y, uint lod); /* page x,y of that level, valid until it gets evicted */
+void texer_virtual_free(texer_virtual_t* vt);
 
 /* scope api */
 #define texer(tex, builder)                     _texer_threaded(tex,builder,0,1)
 #define texer_threaded(tex, builder, id, count) _texer_threaded(tex,builder,id,count)
 #define texer_rect(x,y,h,w)                     _texer_rect(x,y,h,w)
 
+/* runs the builder once per seed, writing variant i into layer i of an array texture.
+ * all variants share one traversal, so the pixel loop is not repeated per seed. */
+#define texer_variants(tex, builder, seeds, count)                     _texer_variants(tex,builder,seeds,count,0,1)
+#define texer_variants_threaded(tex, builder, seeds, count, id, thread_count) _texer_variants(tex,builder,seeds,count,id,thread_count)
+
+/* progressive generation: runs the builder once per 2^level x 2^level block (at its center) and fills the
+ * whole block with the result, e.g. level 3 costs 1/64 of a full build. rect parameters stay in full resolution
+ * coordinates and the texture keeps its size, so every level can be published as it completes:
+ *   for (int level = 3; level >= 0; level--) { texer_level(tex, builder, level) { ... } upload(tex); }
+ * every pixel starts out transparent like in a new texture, so a level fully replaces the previous one */
+#define texer_level(tex, builder, level)                     _texer_level(tex,builder,level,0,1)
+#define texer_level_threaded(tex, builder, level, id, count) _texer_level(tex,builder,level,id,count)
+
+/* only traverses the rect x,y,w,h of the texture (at a level of texer_level(), 0 for full resolution), e.g. to
+ * spread a build over several frames one tile at a time. NOTE: x,y,w,h should be multiples of 2^level */
+#define texer_tile(tex, builder, level, x, y, w, h)          _texer_blocks(tex,builder,level,x,y,(x)+(w),(y)+(h),0,1)
+
+/* runs the builder body once and records rect scopes (incl. rectcuts and outline) and color, noise, outline,
+ * voronoi, seed, blend, height and roughness into program instead of drawing. all parameters are evaluated once,
+ * at record time. other ops and scopes can't be recorded, they set program.unrecordable and are left out (shaped
+ * and transformed scopes skip their body), so the program is incomplete then. builder only provides the size,
+ * nothing is drawn into it, e.g.
+ *   texer_program_t program = {0};
+ *   texer_record(&program, builder) { color(GRAY); texer_rect(8,8,16,16) { noise(0.3); } }
+ *   assert(!program.unrecordable);
+ *   texer_program_run(builder, program, tile_x, tile_y, 32, 32); // for every tile, on any thread */
+#define texer_record(program, builder) \
+    for (texer_t temp = _record(program, builder); temp.i == 0; temp.i += 1) \
+        for (int pixel_x = 0, pixel_y = 0, UNIQUE_VAR(j) = 0; UNIQUE_VAR(j) == 0; UNIQUE_VAR(j)++)
+
+/* executes the program instruction by instruction against the rect x,y,w,h (e.g. a tile) of the builder's texture,
+ * every instruction sweeps the rows of the tile that its rect covers. returns 0 if the code is malformed, or
+ * without drawing anything if program.unrecordable is set */
+int texer_program_run(texer_t builder, texer_program_t program, int x, int y, int w, int h);
+
+/* anti-aliased shaped scopes, content is clipped to the shape and its bounding box */
+#define texer_circle(x,y,r)                     _texer_sdf(CLIPPING_SDF_CIRCLE, (x)-(r), (y)-(r), 2*(r), 2*(r), r) /* x,y is the center */
+#define texer_rounded_rect(x,y,w,h,r)           _texer_sdf(CLIPPING_SDF_BOX, x, y, w, h, r)
+#define texer_masked(mask,x,y)                  _texer_masked(mask,x,y) /* x,y is the top left corner of the mask */
+
+/* content of the scope is drawn through an affine map (relative to the current rect), e.g. rotated:
+ * texer_transform(texer_rotation(0.5f, 16, 16)) { texer_rect(8,8,16,16) { color(RED); } } */
+#define texer_transform(m)                      _texer_transform(m)
+texer_affine_t texer_affine(float a, float b, float c, float d, float tx, float ty);
+texer_affine_t texer_rotation(float angle, float pivot_x, float pivot_y);
+
 #define texer_rectcut_top(cut)                  _texer_rectcut_top(cut)
 #define texer_rectcut_left(cut)                 _texer_rectcut_left(cut)
 #define texer_rectcut_right(cut)                _texer_rectcut_right(cut)
@@ -123,19 +455,54 @@ texer_t texture(int w, int h);
 /* drawing api */
 #define        color(...) temp = _color(temp, pixel_x, pixel_y, __VA_ARGS__)
 texer_t _color(texer_t tex, int pixel_x, int pixel_y, color_t color);
-#define        seed(nr)   temp.seed = nr
+#define        seed(nr)   temp = _seed(temp, nr)
+texer_t _seed(texer_t tex, uint nr);
+#define        blend(mode)  temp = _set_blend(temp, mode) /* e.g. blend(TEXER_BLEND_MULTIPLY) */
+texer_t _set_blend(texer_t tex, uint mode);
+#define        height(h)    temp = _set_height(temp, h)
+texer_t _set_height(texer_t tex, float height);
+#define        roughness(r) temp = _set_roughness(temp, r)
+texer_t _set_roughness(texer_t tex, float roughness);
 #define        noise(...) temp = _noise(temp, pixel_x, pixel_y, __VA_ARGS__)
 texer_t _noise(texer_t  tex, int pixel_x, int pixel_y, float intensity); /* TODO should take a color value */
+#define        perlin(...) temp = _perlin(temp, pixel_x, pixel_y, __VA_ARGS__)
+texer_t _perlin(texer_t tex, int pixel_x, int pixel_y, float intensity, float cell_size);
+#define        fbm(...)    temp = _fbm(temp, pixel_x, pixel_y, __VA_ARGS__) /* e.g. fbm(0.5, 16, 4, 2.0, 0.5) */
+texer_t _fbm(texer_t tex, int pixel_x, int pixel_y, float intensity, float cell_size, uint octaves, float lacunarity, float gain);
 #define        outline(color,thick) temp = _outline(temp, pixel_x, pixel_y, color, thick); _texer_rect(thick,thick,temp.mask.h-(thick*2),temp.mask.w-(thick*2)) /* TODO why do we need (thick*2) here? */
 texer_t _outline(texer_t tex, int pixel_x, int pixel_y, color_t color, uint thickness);
 #define        voronoi(...) temp = _voronoi(temp, pixel_x, pixel_y, ##__VA_ARGS__)
 texer_t _voronoi(texer_t tex, int pixel_x, int pixel_y, uint seed_points); /* TODO should take a color value */
+#define        blit(...)  temp = _blit(temp, pixel_x, pixel_y, __VA_ARGS__) /* NOTE: src must not be the texture that is being built */
+texer_t _blit(texer_t tex, int pixel_x, int pixel_y, texture_t src, int x, int y);
+#define        blit_scaled(...) temp = _blit_scaled(temp, pixel_x, pixel_y, __VA_ARGS__) /* every src pixel becomes a scale x scale block, 0 is treated as 1 */
+texer_t _blit_scaled(texer_t tex, int pixel_x, int pixel_y, texture_t src, int x, int y, uint scale);
+#define        text(...)  temp = _text(temp, pixel_x, pixel_y, __VA_ARGS__) /* e.g. text(hello, 2, 2, WHITE) with hello = texer_text(font, "HELLO"), lowercase is drawn as uppercase */
+texer_t _text(texer_t tex, int pixel_x, int pixel_y, texer_text_t run, int x, int y, color_t color);
+#define        line(...)  temp = _line(temp, pixel_x, pixel_y, __VA_ARGS__) /* e.g. line(0, 0, 31, 31, 1.5, RED), anti-aliased with round caps */
+texer_t _line(texer_t tex, int pixel_x, int pixel_y, float x0, float y0, float x1, float y1, float thickness, color_t color);
+#define        lines(...) temp = _lines(temp, pixel_x, pixel_y, __VA_ARGS__) /* e.g. lines(cracks, BLACK) with cracks = texer_lines(...) */
+texer_t _lines(texer_t tex, int pixel_x, int pixel_y, texer_lines_t batch, color_t color);
+/* ops on a distance field, x,y is the top left corner of the mask the field was computed from */
+#define        stroke(...) temp = _stroke(temp, pixel_x, pixel_y, __VA_ARGS__) /* e.g. stroke(field, 0, 0, 2, BLACK), outline of any shape */
+texer_t _stroke(texer_t tex, int pixel_x, int pixel_y, texer_field_t field, int x, int y, float thickness, color_t color);
+#define        glow(...)   temp = _glow(temp, pixel_x, pixel_y, __VA_ARGS__) /* glows outwards for a positive radius, inwards for a negative one */
+texer_t _glow(texer_t tex, int pixel_x, int pixel_y, texer_field_t field, int x, int y, float radius, color_t color);
+#define        bevel(...)  temp = _bevel(temp, pixel_x, pixel_y, __VA_ARGS__) /* raises the height target by depth, ramping up over width pixels from the edge */
+texer_t _bevel(texer_t tex, int pixel_x, int pixel_y, texer_field_t field, int x, int y, float width, float depth);
 /* for debugging */
 #define        pixel(...) temp = _pixel(temp, ##__VA_ARGS__) // places a pixel at the current {x,y} start
 texer_t _pixel(texer_t tex);
 
 /* called by internally by macros */
 texer_t _set_mask(texer_t* builder, uint x, uint y, uint width, uint height);
+texer_t _push_rect(texer_t* builder, uint x, uint y, uint width, uint height, int pixel_x, int pixel_y);
+texer_t _pop_rect(texer_t old);
+texer_t _record(texer_program_t* program, texer_t builder);
+texer_t _push_sdf(texer_t* builder, uint type, int x, int y, int width, int height, int radius, int pixel_x, int pixel_y);
+texer_t _push_mask(texer_t* builder, texer_mask_t mask, int x, int y, int pixel_x, int pixel_y);
+texer_t _push_transform(texer_t* builder, texer_affine_t m, int pixel_x, int pixel_y);
+int     _set_variant(texer_t* builder, const uint* seeds);
 
 /* helper macros */
 #define TOKEN_PASTE(a, b) a##b
@@ -147,44 +514,213 @@ texer_t _set_mask(texer_t* builder, uint x, uint y, uint width, uint height);
 
 /* helper functions */
 static inline float step(float edge, float x) { return x >= edge ? 1.0f : 0.0f; }
-/* TODO convert to function */
-#define clip_to_region(mask, px, py) (step(mask.x, px) * step(px, mask.x + mask.w-1) * step(mask.y, py) * step(py, mask.y + mask.h-1))
 static inline color_t alpha_blend(color_t src, color_t dst) {
     color_t blend;
     blend.r = CLAMP(src.r * src.a + dst.r * (1.0f - src.a), 0.0f, 1.0f);
     blend.g = CLAMP(src.g * src.a + dst.g * (1.0f - src.a), 0.0f, 1.0f);
     blend.b = CLAMP(src.b * src.a + dst.b * (1.0f - src.a), 0.0f, 1.0f);
-    blend.a = 0.0f; // TODO for some reason we need to set it to 0 not see glClearColor...
+    blend.a = CLAMP(src.a + dst.a * (1.0f - src.a), 0.0f, 1.0f);
     return blend;
 }
+/* composite the blended color b over dst with the opacity of src */
+static inline color_t _composite(color_t b, color_t src, color_t dst) {
+    color_t blend;
+    blend.r = CLAMP(b.r * src.a + dst.r * (1.0f - src.a), 0.0f, 1.0f);
+    blend.g = CLAMP(b.g * src.a + dst.g * (1.0f - src.a), 0.0f, 1.0f);
+    blend.b = CLAMP(b.b * src.a + dst.b * (1.0f - src.a), 0.0f, 1.0f);
+    blend.a = CLAMP(src.a + dst.a * (1.0f - src.a), 0.0f, 1.0f);
+    return blend;
+}
+static inline color_t additive_blend(color_t src, color_t dst) {
+    color_t b = { src.r + dst.r, src.g + dst.g, src.b + dst.b, 0 };
+    return _composite(b, src, dst);
+}
+static inline color_t multiply_blend(color_t src, color_t dst) {
+    color_t b = { src.r * dst.r, src.g * dst.g, src.b * dst.b, 0 };
+    return _composite(b, src, dst);
+}
+static inline color_t screen_blend(color_t src, color_t dst) {
+    color_t b = { 1.0f - (1.0f - src.r) * (1.0f - dst.r), 1.0f - (1.0f - src.g) * (1.0f - dst.g), 1.0f - (1.0f - src.b) * (1.0f - dst.b), 0 };
+    return _composite(b, src, dst);
+}
+static inline float _overlay(float s, float d) { return (d < 0.5f) ? (2.0f * s * d) : (1.0f - 2.0f * (1.0f - s) * (1.0f - d)); }
+static inline color_t overlay_blend(color_t src, color_t dst) {
+    color_t b = { _overlay(src.r, dst.r), _overlay(src.g, dst.g), _overlay(src.b, dst.b), 0 };
+    return _composite(b, src, dst);
+}
+static color_t (*const texer_blend_modes[TEXER_BLEND_COUNT])(color_t src, color_t dst) = {
+    alpha_blend, additive_blend, multiply_blend, screen_blend, overlay_blend,
+};
+/* blend the current material into the other targets with the given opacity */
+static inline void _blend_material(texer_t tex, uint index, float alpha) {
+    if (tex.targets.height)    { tex.targets.height[index]    += (tex.material.height    - tex.targets.height[index])    * alpha; }
+    if (tex.targets.roughness) { tex.targets.roughness[index] += (tex.material.roughness - tex.targets.roughness[index]) * alpha; }
+}
+/* TEXER_TARGET_FIXED16: alpha_blend never divides by alpha, so the colors it leaves behind are premultiplied
+ * already. in fixed point, compositing them is one integer multiply-add per channel (dst = src + dst * (1 - src.a))
+ * and stays within [0,1] without clamping, as long as src is premultiplied and within [0,1] itself */
+#define TEXER_FIXED_ONE (1 << 15)
+static inline unsigned short _to_fixed(float value) { return (unsigned short) (CLAMP(value, 0.0f, 1.0f) * TEXER_FIXED_ONE + 0.5f); }
+static inline color_t _fixed_color(const unsigned short* fixed) {
+    const float scale = 1.0f / TEXER_FIXED_ONE;
+    return (color_t) { fixed[0] * scale, fixed[1] * scale, fixed[2] * scale, fixed[3] * scale };
+}
+static inline void _set_fixed(unsigned short* fixed, color_t color) {
+    fixed[0] = _to_fixed(color.r); fixed[1] = _to_fixed(color.g); fixed[2] = _to_fixed(color.b); fixed[3] = _to_fixed(color.a);
+}
+/* color of a pixel of the texture that is being built, wherever it is stored */
+static inline color_t _pixel_color(texer_t tex, uint index) {
+    return tex.targets.fixed ? _fixed_color(tex.targets.fixed + 4 * index) : tex.tex.rgb[index];
+}
+static inline void _set_pixel(texer_t tex, uint index, color_t color) {
+    if (tex.targets.fixed) { _set_fixed(tex.targets.fixed + 4 * index, color); }
+    else                   { tex.tex.rgb[index] = color; }
+}
+/* blend a color with its alpha already multiplied by the clip into the texture and the current material into the other targets */
+static inline void _blend_pixel(texer_t tex, uint index, color_t color) {
+    if (!tex.targets.fixed) {
+        tex.tex.rgb[index] = (tex.blend)(color, tex.tex.rgb[index]); /* NOTE: parentheses keep blend() from expanding */
+    } else if (tex.blend == alpha_blend) {
+        /* premultiply the source once, then every channel is a multiply-add and a shift */
+        float alpha  = CLAMP(color.a, 0.0f, 1.0f);
+        uint  src[4] = { _to_fixed(CLAMP(color.r, 0.0f, 1.0f) * alpha), _to_fixed(CLAMP(color.g, 0.0f, 1.0f) * alpha),
+                         _to_fixed(CLAMP(color.b, 0.0f, 1.0f) * alpha), _to_fixed(alpha) };
+        uint  remain = TEXER_FIXED_ONE - src[3];
+        unsigned short* dst = tex.targets.fixed + 4 * index;
+        for (int channel = 0; channel < 4; channel++) {
+            dst[channel] = src[channel] + ((dst[channel] * remain + TEXER_FIXED_ONE / 2) >> 15);
+        }
+    } else {
+        /* other blend modes go through float */
+        _set_fixed(tex.targets.fixed + 4 * index, (tex.blend)(color, _fixed_color(tex.targets.fixed + 4 * index)));
+    }
+    _blend_material(tex, index, color.a);
+}
 static inline int squared_distance(int x1, int y1, int x2, int y2) { return (x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2); }
 const int  I32_MAX      = 0x7FFFFFFF;
 const uint U32_MAX      = 4294967295;
 static inline uint _rand(uint index) { index = (index << 13) ^ index; return ((index * (index * index * 15731 + 789221) + 1376312589) & 0x7fffffff); };
+/* index of the first pixel get_index walks from, depends on orientation and layer */
+static inline int _origin(texer_t texer, uint layer) {
+    int w = texer.atlas_width;
+    int h = texer.atlas_height;
+    return (layer * w * h) + ((texer.tex.flags & TEXER_FLAG_FLIP)   ? (h - 1) * w : 0)
+                           + ((texer.tex.flags & TEXER_FLAG_MIRROR) ? (w - 1)     : 0);
+}
+/* 2d gradient noise in [-1,1] with a lattice cell of size 1, only depends on its inputs so every
+ * pixel can be evaluated on its own (same result regardless of thread count or evaluation order) */
+static inline float _gradient_noise(float x, float y, uint seed) {
+    static const float gradients[8][2] = { { 1, 0}, {-1, 0}, { 0, 1}, { 0,-1},
+                                           { 0.70710678f, 0.70710678f}, {-0.70710678f, 0.70710678f},
+                                           { 0.70710678f,-0.70710678f}, {-0.70710678f,-0.70710678f} };
+    int ix = (int) x; if (x < ix) { ix -= 1; } /* floor */
+    int iy = (int) y; if (y < iy) { iy -= 1; }
+    float fx = x - ix;
+    float fy = y - iy;
+
+    /* gradients of the four corners. NOTE: the low bits of _rand() only depend on the low bits of its input,
+     * which would repeat the gradients every 8 cells, so the high bits pick the gradient */
+    const float* g00 = gradients[(_rand(seed + (ix    ) * 1619 + (iy    ) * 31337) >> 16) & 7];
+    const float* g10 = gradients[(_rand(seed + (ix + 1) * 1619 + (iy    ) * 31337) >> 16) & 7];
+    const float* g01 = gradients[(_rand(seed + (ix    ) * 1619 + (iy + 1) * 31337) >> 16) & 7];
+    const float* g11 = gradients[(_rand(seed + (ix + 1) * 1619 + (iy + 1) * 31337) >> 16) & 7];
+
+    float n00 = g00[0] * (fx       ) + g00[1] * (fy       );
+    float n10 = g10[0] * (fx - 1.0f) + g10[1] * (fy       );
+    float n01 = g01[0] * (fx       ) + g01[1] * (fy - 1.0f);
+    float n11 = g11[0] * (fx - 1.0f) + g11[1] * (fy - 1.0f);
+
+    /* quintic fade curve */
+    float u = fx * fx * fx * (fx * (fx * 6.0f - 15.0f) + 10.0f);
+    float v = fy * fy * fy * (fy * (fy * 6.0f - 15.0f) + 10.0f);
+
+    float nx0 = n00 + u * (n10 - n00);
+    float nx1 = n01 + u * (n11 - n01);
+    return (nx0 + v * (nx1 - nx0)) * 1.41421356f; /* scale from [-1/sqrt(2),1/sqrt(2)] to [-1,1] */
+}
+/* distance of the point to the line segment */
+static inline float _segment_distance(float px, float py, float x0, float y0, float x1, float y1) {
+    float dx = x1 - x0, dy = y1 - y0;
+    float len2 = dx * dx + dy * dy;
+    float t = (len2 > 0.0f) ? CLAMP(((px - x0) * dx + (py - y0) * dy) / len2, 0.0f, 1.0f) : 0.0f;
+    float ex = px - (x0 + t * dx);
+    float ey = py - (y0 + t * dy);
+    return sqrtf(ex * ex + ey * ey);
+}
+/* same as get_index for reading a finished texture, honors the orientation it was built with */
+static inline uint texture_index(texture_t tex, uint layer, uint x, uint y) {
+    if (tex.flags & TEXER_FLAG_FLIP)   { y = tex.height - y - 1; }
+    if (tex.flags & TEXER_FLAG_MIRROR) { x = tex.width  - x - 1; }
+    return (layer * tex.height + y) * tex.width + x;
+}
 static inline uint get_index(texer_t texer, uint pixel_x, uint pixel_y) {
     /* NOTE: a shearing effect can be implemented by doing atlas_width-{1,2,3,...} */
-    #ifdef TEXER_FLAG_FLIP
-    return (texer.atlas_height - pixel_y - 1) * (texer.atlas_width) + pixel_x;
-    #else
-    return (pixel_y * texer.atlas_width) + pixel_x;
-    #endif
+    return texer.origin + (int) pixel_y * texer.pitch + (int) pixel_x * texer.step;
+}
+/* progressive generation, see texer_level() */
+static inline int _block_center(int block, uint level, uint size) { return min((block << level) + ((1 << level) >> 1), (int) size - 1); }
+static inline int _clear_pixel(texer_t tex, int pixel_x, int pixel_y) {
+    uint index = get_index(tex, pixel_x, pixel_y);
+    _set_pixel(tex, index, (color_t) {0});
+    if (tex.targets.height)    { tex.targets.height[index]    = 0.0f; }
+    if (tex.targets.roughness) { tex.targets.roughness[index] = 0.0f; }
+    return 0;
+}
+static inline void _fill_block(texer_t tex, int block_x, int block_y, uint level) {
+    if (level == 0) { return; }
+    int x0 = block_x << level, x1 = min(x0 + (1 << level), (int) tex.atlas_width);
+    int y0 = block_y << level, y1 = min(y0 + (1 << level), (int) tex.atlas_height);
+    uint center = get_index(tex, _block_center(block_x, level, tex.atlas_width), _block_center(block_y, level, tex.atlas_height));
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            uint index = get_index(tex, x, y);
+            _set_pixel(tex, index, _pixel_color(tex, center));
+            if (tex.targets.height)    { tex.targets.height[index]    = tex.targets.height[center]; }
+            if (tex.targets.roughness) { tex.targets.roughness[index] = tex.targets.roughness[center]; }
+        }
+    }
 }
 
-static inline float sdf(clipping_sdf_t sdf) {
+/* signed distance of the pixel center to the shape, negative inside */
+static inline float sdf(clipping_sdf_t sdf, int pixel_x, int pixel_y) {
+    /* relative to the center of the bounding box */
+    float px = (pixel_x + 0.5f) - (sdf.x + 0.5f * sdf.w);
+    float py = (pixel_y + 0.5f) - (sdf.y + 0.5f * sdf.h);
     float in = 0;
     switch (sdf.type) {
         case CLIPPING_SDF_BOX : {
-            //vec2 d = abs(p)-b;
-            //in = length(max(d,0.0)) + min(max(d.x,d.y),0.0);
+            float qx = fabsf(px) - (0.5f * sdf.w - sdf.r);
+            float qy = fabsf(py) - (0.5f * sdf.h - sdf.r);
+            /* NOTE: only the corners need a square root */
+            if (qx <= 0.0f || qy <= 0.0f) { in = max(qx, qy) - sdf.r; }
+            else                          { in = sqrtf(qx * qx + qy * qy) - sdf.r; }
         } break;
         case CLIPPING_SDF_CIRCLE : {
-            //in = length(p) - r;
+            in = sqrtf(px * px + py * py) - sdf.r;
         } break;
     }
 
     return in;
 };
 
+/* coverage of the pixel in [0,1]. NOTE: scopes skip their body for pixels outside of their rect or
+ * with zero coverage, so what is left to do here is the accumulated coverage of shaped scopes */
+static inline float clip_to_region(texer_t tex, int px, int py) {
+    return tex.coverage;
+}
+static inline int inside_region(texer_t tex, int px, int py) {
+    return (px >= tex.mask.x) && (px < tex.mask.x + tex.mask.w) && (py >= tex.mask.y) && (py < tex.mask.y + tex.mask.h);
+}
+/* coverage of a mask texel in [0,1], only partially covered tiles need to look at the coverage */
+static inline float _mask_coverage(texer_mask_t mask, uint x, uint y) {
+    uint tile = (y / TEXER_TILE_SIZE) * mask.tiles_x + (x / TEXER_TILE_SIZE);
+    switch (mask.tiles[tile]) {
+        case TEXER_TILE_EMPTY : { return 0.0f; } break;
+        case TEXER_TILE_FULL  : { return 1.0f; } break;
+    }
+    return mask.coverage[tile * TEXER_TILE_SIZE * TEXER_TILE_SIZE + (y % TEXER_TILE_SIZE) * TEXER_TILE_SIZE + (x % TEXER_TILE_SIZE)] / 255.0f;
+}
+
 #ifndef RUN_ON_COMPUTE_SHADER
   #define _texer_for_every_pixel(thread_id, thread_count) \
       for (int pixel_x = thread_id; pixel_x < temp.atlas_width; pixel_x += thread_count) \
@@ -195,15 +731,51 @@ static inline float sdf(clipping_sdf_t sdf) {
       for (int pixel_x = gl_GlobalInvocationID.x, pixel_y = gl_GlobalInvocationID.y, UNIQUE_VAR(i) = 0; UNIQUE_VAR(i) == 0; UNIQUE_VAR(i)++ )
 #endif
 
+#ifndef RUN_ON_COMPUTE_SHADER
+  /* NOTE: threads get every thread_count-th column of blocks in the rect, the block is filled once the body is done */
+  #define _texer_blocks(tex, builder, level, x0, y0, x1, y1, thread_id, thread_count) \
+      for (texer_t temp = builder; temp.i == 0; (temp.i+=1, tex = _create(temp))) \
+          for (int UNIQUE_VAR(block_x) = ((x0) >> (level)) + (thread_id); (UNIQUE_VAR(block_x) << (level)) < min((int) (x1), (int) temp.atlas_width); UNIQUE_VAR(block_x) += thread_count) \
+              for (int UNIQUE_VAR(block_y) = (y0) >> (level); (UNIQUE_VAR(block_y) << (level)) < min((int) (y1), (int) temp.atlas_height); _fill_block(temp, UNIQUE_VAR(block_x), UNIQUE_VAR(block_y), level), UNIQUE_VAR(block_y)++) \
+                  for (int pixel_x = _block_center(UNIQUE_VAR(block_x), level, temp.atlas_width), \
+                           pixel_y = _block_center(UNIQUE_VAR(block_y), level, temp.atlas_height), \
+                           UNIQUE_VAR(j) = _clear_pixel(temp, pixel_x, pixel_y); UNIQUE_VAR(j) == 0; UNIQUE_VAR(j)++)
+#else
+  /* NOTE: every invocation is a single pixel anyway */
+  #define _texer_blocks(tex, builder, level, x0, y0, x1, y1, thread_id, thread_count) _texer_threaded(tex, builder, thread_id, thread_count)
+#endif
+#define _texer_level(tex, builder, level, thread_id, thread_count) _texer_blocks(tex, builder, level, 0, 0, temp.atlas_width, temp.atlas_height, thread_id, thread_count)
+
 #define _texer_threaded(tex, builder, thread_id, thread_count)                       \
     for (texer_t temp = builder; temp.i == 0; (temp.i+=1, tex = _create(temp)))      \
         _texer_for_every_pixel(thread_id, thread_count)
 
+#define _texer_variants(tex, builder, seeds, count, thread_id, thread_count)             \
+    _texer_threaded(tex, builder, thread_id, thread_count)                               \
+        for (temp.layer = 0; temp.layer < (count) && _set_variant(&temp, seeds); temp.layer++)
+
 #define _texer_rect(x,y,w,h) \
-    for (texer_t UNIQUE_VAR(old_builder) = _set_mask(&temp, x,y,w,h); \
+    for (texer_t UNIQUE_VAR(old_builder) = _push_rect(&temp, x,y,w,h, pixel_x,pixel_y); \
+         UNIQUE_VAR(old_builder).i == 0;                                    \
+         (temp = _pop_rect(UNIQUE_VAR(old_builder)), UNIQUE_VAR(old_builder).i+=1))
+
+#define _texer_sdf(type,x,y,w,h,r) \
+    for (texer_t UNIQUE_VAR(old_builder) = _push_sdf(&temp, type, x,y,w,h,r, pixel_x,pixel_y); \
          UNIQUE_VAR(old_builder).i == 0;                                    \
          (temp = UNIQUE_VAR(old_builder), UNIQUE_VAR(old_builder).i+=1))
 
+#define _texer_masked(mask,x,y) \
+    for (texer_t UNIQUE_VAR(old_builder) = _push_mask(&temp, mask, x,y, pixel_x,pixel_y); \
+         UNIQUE_VAR(old_builder).i == 0;                                    \
+         (temp = UNIQUE_VAR(old_builder), UNIQUE_VAR(old_builder).i+=1))
+
+/* NOTE: pixel_x and pixel_y are set to the content coordinates for the body and set back to the pixel (kept in
+ * the old builder's transformed) on exit, instead of being redeclared, which -Wshadow would complain about */
+#define _texer_transform(m) \
+    for (texer_t UNIQUE_VAR(old_builder) = _push_transform(&temp, m, pixel_x,pixel_y); \
+         UNIQUE_VAR(old_builder).i == 0 && (pixel_x = temp.transformed.x, pixel_y = temp.transformed.y, 1); \
+         (temp = UNIQUE_VAR(old_builder), pixel_x = temp.transformed.x, pixel_y = temp.transformed.y, UNIQUE_VAR(old_builder).i+=1))
+
 #define _texer_rectcut_top(cut)    _texer_rect(                 0,                  0, temp.mask.w,         cut)
 #define _texer_rectcut_left(cut)   _texer_rect(                 0,                  0,         cut, temp.mask.h)
 #define _texer_rectcut_right(cut)  _texer_rect((temp.mask.w- cut),                  0,         cut, temp.mask.h)
@@ -211,35 +783,104 @@ static inline float sdf(clipping_sdf_t sdf) {
 
 /* internal */
 #ifdef TEXER_IMPLEMENTATION
-#include <stdlib.h> // for malloc
+#include <stdlib.h> // for malloc, calloc
+#include <string.h> // for memcmp, memcpy, strlen
 #include <assert.h> // TODO take in assert macro from user
+#include <stdarg.h> // for va_list
+
+/* TEXER_TARGET_FIXED16 builds have no float colors, texture_t consumers can only take other textures */
+#define _assert_colors(tex) assert((tex).rgb != NULL && "built with TEXER_TARGET_FIXED16, read it with texture_rgba8()")
+
+/* recording, see texer_record() */
+static void _emit(texer_program_t* program, const unsigned char* bytes, size_t size) {
+    if (program->size + size > program->capacity) {
+        program->capacity = max(2 * program->capacity, program->size + size + 256);
+        program->code     = realloc(program->code, program->capacity);
+    }
+    memcpy(program->code + program->size, bytes, size);
+    program->size += size;
+}
+static void _emit_op(texer_program_t* program, unsigned char op) { _emit(program, &op, 1); }
+static void _emit_u32(texer_program_t* program, uint value) {
+    unsigned char bytes[4] = { value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, value >> 24 };
+    _emit(program, bytes, 4);
+}
+static void _emit_float(texer_program_t* program, float value) {
+    uint bits;
+    memcpy(&bits, &value, 4);
+    _emit_u32(program, bits);
+}
+static void _emit_color(texer_program_t* program, color_t color) {
+    _emit_float(program, color.r); _emit_float(program, color.g); _emit_float(program, color.b); _emit_float(program, color.a);
+}
+static uint _read_u32(const unsigned char* bytes) {
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint) bytes[3] << 24);
+}
+static float _read_float(const unsigned char* bytes) {
+    uint bits = _read_u32(bytes);
+    float value;
+    memcpy(&value, &bits, 4);
+    return value;
+}
+static color_t _read_color(const unsigned char* bytes) {
+    return (color_t) { _read_float(bytes), _read_float(bytes + 4), _read_float(bytes + 8), _read_float(bytes + 12) };
+}
+
+/* ops and scopes that can't be recorded flag the program instead of drawing into the scratch pixel */
+static texer_t _unrecordable(texer_t tex) {
+    tex.program->unrecordable = 1;
+    return tex;
+}
+
+texer_t _seed(texer_t tex, uint nr) {
+    tex.seed = nr ^ tex.variant_seed;
+    if (tex.program) { _emit_op(tex.program, TEXER_OP_SEED); _emit_u32(tex.program, tex.seed); }
+    return tex;
+}
+texer_t _set_blend(texer_t tex, uint mode) {
+    tex.blend = texer_blend_modes[mode];
+    if (tex.program) { _emit_op(tex.program, TEXER_OP_BLEND); _emit_u32(tex.program, mode); }
+    return tex;
+}
+texer_t _set_height(texer_t tex, float height) {
+    tex.material.height = height;
+    if (tex.program) { _emit_op(tex.program, TEXER_OP_HEIGHT); _emit_float(tex.program, height); }
+    return tex;
+}
+texer_t _set_roughness(texer_t tex, float roughness) {
+    tex.material.roughness = roughness;
+    if (tex.program) { _emit_op(tex.program, TEXER_OP_ROUGHNESS); _emit_float(tex.program, roughness); }
+    return tex;
+}
 texer_t _color(texer_t tex, int pixel_x, int pixel_y, color_t color) {
-    float clip = clip_to_region(tex.mask, pixel_x, pixel_y);
+    if (tex.program) { _emit_op(tex.program, TEXER_OP_COLOR); _emit_color(tex.program, color); return tex; }
+
+    float clip = clip_to_region(tex, pixel_x, pixel_y);
 
-    color.r *= clip;
-    color.g *= clip;
-    color.b *= clip;
     color.a *= clip;
 
     /* color the subtexture */
     uint index = get_index(tex, pixel_x, pixel_y);
-    tex.tex.rgb[index] = alpha_blend(color, tex.tex.rgb[index]);
+    _blend_pixel(tex, index, color);
 
     return tex;
 }
 texer_t _noise(texer_t tex, int pixel_x, int pixel_y, float intensity)  {
-    float clip = clip_to_region(tex.mask, pixel_x, pixel_y);
+    if (tex.program) { _emit_op(tex.program, TEXER_OP_NOISE); _emit_float(tex.program, intensity); return tex; }
+
+    float clip = clip_to_region(tex, pixel_x, pixel_y);
 
     if (!(clip > 0.0f)) { return tex; }; /* NOTE: early out is actually faster on CPUs (still needs testing with shaders)  */
 
     uint idx = get_index(tex, pixel_x, pixel_y);
+    color_t dst = _pixel_color(tex, idx);
     color_t noise;
 
     /* Add noise to each color component based on intensity */
     // TODO better pseudo random number generation
-    noise.r = tex.tex.rgb[idx].r + intensity * ((float)_rand(tex.seed+pixel_x+pixel_y)/(float) U32_MAX - 0.5f);
-    noise.g = tex.tex.rgb[idx].g + intensity * ((float)_rand(tex.seed+pixel_x+pixel_y)/(float) U32_MAX - 0.5f);
-    noise.b = tex.tex.rgb[idx].b + intensity * ((float)_rand(tex.seed+pixel_x+pixel_y)/(float) U32_MAX - 0.5f);
+    noise.r = dst.r + intensity * ((float)_rand(tex.seed+pixel_x+pixel_y)/(float) U32_MAX - 0.5f);
+    noise.g = dst.g + intensity * ((float)_rand(tex.seed+pixel_x+pixel_y)/(float) U32_MAX - 0.5f);
+    noise.b = dst.b + intensity * ((float)_rand(tex.seed+pixel_x+pixel_y)/(float) U32_MAX - 0.5f);
 
     /* NOTE: sheared stripes pattern, could be nice to have as a drawing operation */
     //noise.r = tex.tex.rgb[idx].r + intensity * ((float)_rand(tex.seed+pixel_x+pixel_y)/(float) U32_MAX - 0.5f);
@@ -247,42 +888,240 @@ texer_t _noise(texer_t tex, int pixel_x, int pixel_y, float intensity)  {
     //noise.b = tex.tex.rgb[idx].b + intensity * ((float)_rand(tex.seed+pixel_x+pixel_y)/(float) U32_MAX - 0.5f);
 
     /* clamp colors to [0, 1] and clip if needed */
-    noise.r = CLAMP(noise.r, 0.0f, 1.0f) * clip;
-    noise.g = CLAMP(noise.g, 0.0f, 1.0f) * clip;
-    noise.b = CLAMP(noise.b, 0.0f, 1.0f) * clip;
+    noise.r = CLAMP(noise.r, 0.0f, 1.0f);
+    noise.g = CLAMP(noise.g, 0.0f, 1.0f);
+    noise.b = CLAMP(noise.b, 0.0f, 1.0f);
     noise.a = clip;
 
-    tex.tex.rgb[idx] = alpha_blend(noise, tex.tex.rgb[idx]);
+    _blend_pixel(tex, idx, noise);
+
+    return tex;
+}
+/* offset the color by n in [-1,1], scaled the same way _noise scales its white noise */
+static texer_t _offset_color(texer_t tex, int pixel_x, int pixel_y, float clip, float n) {
+    uint idx = get_index(tex, pixel_x, pixel_y);
+    color_t dst = _pixel_color(tex, idx);
+    color_t offset;
+    offset.r = CLAMP(dst.r + 0.5f * n, 0.0f, 1.0f);
+    offset.g = CLAMP(dst.g + 0.5f * n, 0.0f, 1.0f);
+    offset.b = CLAMP(dst.b + 0.5f * n, 0.0f, 1.0f);
+    offset.a = clip;
+    _blend_pixel(tex, idx, offset);
+    return tex;
+}
+texer_t _perlin(texer_t tex, int pixel_x, int pixel_y, float intensity, float cell_size) {
+    if (tex.program) { return _unrecordable(tex); }
+    float clip = clip_to_region(tex, pixel_x, pixel_y);
+    if (!(clip > 0.0f)) { return tex; };
+
+    /* relative to the rect, so the pattern moves along with it */
+    float x = (pixel_x - tex.mask.x) / cell_size;
+    float y = (pixel_y - tex.mask.y) / cell_size;
+
+    return _offset_color(tex, pixel_x, pixel_y, clip, intensity * _gradient_noise(x, y, tex.seed));
+}
+texer_t _fbm(texer_t tex, int pixel_x, int pixel_y, float intensity, float cell_size, uint octaves, float lacunarity, float gain) {
+    if (tex.program) { return _unrecordable(tex); }
+    float clip = clip_to_region(tex, pixel_x, pixel_y);
+    if (!(clip > 0.0f)) { return tex; };
+
+    float x = (pixel_x - tex.mask.x) / cell_size;
+    float y = (pixel_y - tex.mask.y) / cell_size;
+
+    /* sum octaves of increasing frequency and decreasing amplitude */
+    float sum = 0.0f, amplitude = 1.0f, total_amplitude = 0.0f;
+    for (uint octave = 0; octave < octaves; octave++) {
+        sum             += amplitude * _gradient_noise(x, y, tex.seed + octave);
+        total_amplitude += amplitude;
+        amplitude       *= gain;
+        x               *= lacunarity;
+        y               *= lacunarity;
+    }
+    if (total_amplitude > 0.0f) { sum /= total_amplitude; } /* keep result in [-1,1] */
+
+    return _offset_color(tex, pixel_x, pixel_y, clip, intensity * sum);
+}
+texer_t _blit(texer_t tex, int pixel_x, int pixel_y, texture_t src, int x, int y) {
+    return _blit_scaled(tex, pixel_x, pixel_y, src, x, y, 1);
+}
+texer_t _blit_scaled(texer_t tex, int pixel_x, int pixel_y, texture_t src, int x, int y, uint scale) {
+    _assert_colors(src);
+    if (tex.program) { return _unrecordable(tex); }
+    float clip = clip_to_region(tex, pixel_x, pixel_y);
+    if (scale == 0) { scale = 1; } /* would divide by zero, draw it unscaled instead */
+
+    /* relative to the rect, unsigned so that pixels before the texture wrap around and fail the test too */
+    uint local_x = (pixel_x - (tex.mask.x + x)) / scale; /* nearest neighbour */
+    uint local_y = (pixel_y - (tex.mask.y + y)) / scale;
+    if (local_x >= src.width || local_y >= src.height) { return tex; }
+
+    /* the source is premultiplied like everything that was built, ops blend straight colors */
+    color_t color = src.rgb[texture_index(src, 0, local_x, local_y)];
+    if (!(color.a > 0.0f)) { return tex; }
+    if (color.a < 1.0f) { color.r /= color.a; color.g /= color.a; color.b /= color.a; }
+    uint index    = get_index(tex, pixel_x, pixel_y);
+
+    /* opaque source on a fully covered pixel, nothing to blend unless another blend mode is set */
+    if (color.a >= 1.0f && clip >= 1.0f && tex.blend == alpha_blend) {
+        _set_pixel(tex, index, color);
+        _blend_material(tex, index, 1.0f);
+        return tex;
+    }
+
+    color.a *= clip;
+    _blend_pixel(tex, index, color);
+
+    return tex;
+}
+texer_t _text(texer_t tex, int pixel_x, int pixel_y, texer_text_t run, int x, int y, color_t color) {
+    if (tex.program) { return _unrecordable(tex); }
+    float clip = clip_to_region(tex, pixel_x, pixel_y);
+    texer_font_t font = run.font;
+
+    /* relative to the rect, unsigned so that pixels before the text wrap around and fail the test too */
+    uint local_x = pixel_x - (tex.mask.x + x);
+    uint local_y = pixel_y - (tex.mask.y + y);
+    if (local_y >= font.glyph_h || local_x / font.glyph_w >= run.length) { return tex; }
+
+    /* glyphs outside of the font are drawn as '?' */
+    unsigned char c = run.str[local_x / font.glyph_w];
+    if (c >= 'a' && c <= 'z') { c -= 'a' - 'A'; }
+    uint glyph = (c >= 32 && c <= 95) ? c - 32 : '?' - 32;
+
+    float coverage = _mask_coverage(font.atlas, glyph * font.glyph_w + local_x % font.glyph_w, local_y);
+    if (!(coverage > 0.0f)) { return tex; }
+
+    color.a *= clip * coverage;
+    _blend_pixel(tex, get_index(tex, pixel_x, pixel_y), color);
+
+    return tex;
+}
+texer_t _line(texer_t tex, int pixel_x, int pixel_y, float x0, float y0, float x1, float y1, float thickness, color_t color) {
+    if (tex.program) { return _unrecordable(tex); }
+    float clip = clip_to_region(tex, pixel_x, pixel_y);
+
+    /* pixel center relative to the rect */
+    float px = pixel_x + 0.5f - tex.mask.x;
+    float py = pixel_y + 0.5f - tex.mask.y;
+
+    /* reject everything outside of the bounding box before computing the distance */
+    float reach = 0.5f * thickness + 0.5f;
+    if (px < min(x0, x1) - reach || px > max(x0, x1) + reach || py < min(y0, y1) - reach || py > max(y0, y1) + reach) { return tex; }
+
+    float coverage = CLAMP(reach - _segment_distance(px, py, x0, y0, x1, y1), 0.0f, 1.0f);
+    if (!(coverage > 0.0f)) { return tex; }
+
+    color.a *= clip * coverage;
+    _blend_pixel(tex, get_index(tex, pixel_x, pixel_y), color);
+
+    return tex;
+}
+texer_t _lines(texer_t tex, int pixel_x, int pixel_y, texer_lines_t batch, color_t color) {
+    if (tex.program) { return _unrecordable(tex); }
+    float clip = clip_to_region(tex, pixel_x, pixel_y);
+
+    float px = pixel_x + 0.5f - tex.mask.x;
+    float py = pixel_y + 0.5f - tex.mask.y;
+
+    /* unsigned so that pixels before the grid wrap around and fail the test too */
+    uint cell_x = (uint) ((int) floorf(px) - batch.x) / TEXER_LINES_CELL_SIZE;
+    uint cell_y = (uint) ((int) floorf(py) - batch.y) / TEXER_LINES_CELL_SIZE;
+    if (cell_x >= batch.cells_x || cell_y >= batch.cells_y) { return tex; }
+
+    /* NOTE: the closest segment decides, so joints and crossings are not blended twice */
+    uint  cell     = cell_y * batch.cells_x + cell_x;
+    float reach    = 0.5f * batch.thickness + 0.5f;
+    float coverage = 0.0f;
+    for (uint i = batch.cell_start[cell]; i < batch.cell_start[cell + 1] && coverage < 1.0f; i++) {
+        float* s = batch.segments + 4 * batch.cell_segments[i];
+        coverage = max(coverage, CLAMP(reach - _segment_distance(px, py, s[0], s[1], s[2], s[3]), 0.0f, 1.0f));
+    }
+    if (!(coverage > 0.0f)) { return tex; }
+
+    color.a *= clip * coverage;
+    _blend_pixel(tex, get_index(tex, pixel_x, pixel_y), color);
+
+    return tex;
+}
+/* signed distance at the pixel, very far outside for pixels not covered by the field */
+static float _field_distance(texer_t tex, texer_field_t field, int pixel_x, int pixel_y, int x, int y) {
+    uint local_x = pixel_x - (tex.mask.x + x) + field.padding;
+    uint local_y = pixel_y - (tex.mask.y + y) + field.padding;
+    if (local_x >= field.width || local_y >= field.height) { return 1e20f; }
+    return field.distance[local_y * field.width + local_x];
+}
+texer_t _stroke(texer_t tex, int pixel_x, int pixel_y, texer_field_t field, int x, int y, float thickness, color_t color) {
+    if (tex.program) { return _unrecordable(tex); }
+    float clip = clip_to_region(tex, pixel_x, pixel_y);
+    float d    = _field_distance(tex, field, pixel_x, pixel_y, x, y);
+
+    /* band of the given thickness right outside of the edge, anti-aliased on both sides */
+    float coverage = min(CLAMP(d + 0.5f, 0.0f, 1.0f), CLAMP(thickness - d + 0.5f, 0.0f, 1.0f));
+    if (!(coverage > 0.0f)) { return tex; }
+
+    color.a *= clip * coverage;
+    _blend_pixel(tex, get_index(tex, pixel_x, pixel_y), color);
+
+    return tex;
+}
+texer_t _glow(texer_t tex, int pixel_x, int pixel_y, texer_field_t field, int x, int y, float radius, color_t color) {
+    if (tex.program) { return _unrecordable(tex); }
+    float clip = clip_to_region(tex, pixel_x, pixel_y);
+    float d    = _field_distance(tex, field, pixel_x, pixel_y, x, y);
+
+    /* distance into the direction of the glow, quadratic falloff */
+    float r    = fabsf(radius);
+    float dist = (radius > 0.0f) ? d : -d;
+    if (!(dist > -0.5f && dist < r)) { return tex; }
+    float falloff = (1.0f - max(dist, 0.0f) / r) * (1.0f - max(dist, 0.0f) / r) * min(dist + 0.5f, 1.0f);
+
+    color.a *= clip * falloff;
+    _blend_pixel(tex, get_index(tex, pixel_x, pixel_y), color);
+
+    return tex;
+}
+texer_t _bevel(texer_t tex, int pixel_x, int pixel_y, texer_field_t field, int x, int y, float width, float depth) {
+    if (tex.program) { return _unrecordable(tex); }
+    float clip = clip_to_region(tex, pixel_x, pixel_y);
+    float d    = _field_distance(tex, field, pixel_x, pixel_y, x, y);
+    if (!tex.targets.height || !(d < 0.5f)) { return tex; }
+
+    /* NOTE: only the height target is touched, the color stays as it is */
+    float coverage = CLAMP(0.5f - d, 0.0f, 1.0f) * clip;
+    float height   = tex.material.height + depth * CLAMP(-d / width, 0.0f, 1.0f);
+    uint  index    = get_index(tex, pixel_x, pixel_y);
+    tex.targets.height[index] += (height - tex.targets.height[index]) * coverage;
 
     return tex;
 }
 texer_t _outline(texer_t tex, int pixel_x, int pixel_y, color_t color, uint thickness) {
-    float clip = clip_to_region(tex.mask, pixel_x, pixel_y);
+    if (tex.program) { _emit_op(tex.program, TEXER_OP_OUTLINE); _emit_color(tex.program, color); _emit_u32(tex.program, thickness); return tex; }
+
+    float clip = clip_to_region(tex, pixel_x, pixel_y);
 
-    color.r *= clip;
-    color.g *= clip;
-    color.b *= clip;
     color.a *= clip;
 
     uint index = get_index(tex, pixel_x, pixel_y);
 
     /* TODO remove if statements */
     /* top side */
-    if (pixel_y < tex.mask.y + thickness) { tex.tex.rgb[index] = alpha_blend(color, tex.tex.rgb[index]); }
+    if (pixel_y < tex.mask.y + thickness) { _blend_pixel(tex, index, color); }
 
     /* bottom side */
-    if (pixel_y >= tex.mask.y + tex.mask.h - thickness) { tex.tex.rgb[index] = alpha_blend(color, tex.tex.rgb[index]); }
+    if (pixel_y >= tex.mask.y + tex.mask.h - thickness) { _blend_pixel(tex, index, color); }
 
     /* left side */
-    if (pixel_x < tex.mask.x + thickness) { tex.tex.rgb[index] = alpha_blend(color, tex.tex.rgb[index]); }
+    if (pixel_x < tex.mask.x + thickness) { _blend_pixel(tex, index, color); }
 
     /* right side */
-    if (pixel_x >= tex.mask.x + tex.mask.w - thickness) { tex.tex.rgb[index] = alpha_blend(color, tex.tex.rgb[index]); }
+    if (pixel_x >= tex.mask.x + tex.mask.w - thickness) { _blend_pixel(tex, index, color); }
 
     return tex;
 }
 texer_t _voronoi(texer_t tex, int pixel_x, int pixel_y, uint seed_points) {
-    float clip = clip_to_region(tex.mask, pixel_x, pixel_y);
+    if (tex.program) { _emit_op(tex.program, TEXER_OP_VORONOI); _emit_u32(tex.program, seed_points); return tex; }
+
+    float clip = clip_to_region(tex, pixel_x, pixel_y);
 
     /* determine nearest seed point for current pixel */
     int nearest_seed_index = -1;
@@ -299,39 +1138,1249 @@ texer_t _voronoi(texer_t tex, int pixel_x, int pixel_y, uint seed_points) {
 
     /* generate random color based off seed index */
     color_t color;
-    color.r = ((float) _rand(nearest_seed_index + 0)/ (float) U32_MAX) * clip;
-    color.g = ((float) _rand(nearest_seed_index + 1)/ (float) U32_MAX) * clip;
-    color.b = ((float) _rand(nearest_seed_index + 2)/ (float) U32_MAX) * clip;
+    color.r = ((float) _rand(nearest_seed_index + 0)/ (float) U32_MAX);
+    color.g = ((float) _rand(nearest_seed_index + 1)/ (float) U32_MAX);
+    color.b = ((float) _rand(nearest_seed_index + 2)/ (float) U32_MAX);
     color.a = 1.0f * clip;
 
     uint index = get_index(tex, pixel_x, pixel_y);
-    tex.tex.rgb[index] = alpha_blend(color, tex.tex.rgb[index]);
+    _blend_pixel(tex, index, color);
 
     return tex;
 }
 
 texer_t texture(int w, int h) {
+    return texture_array(w, h, 1);
+}
+
+texer_t texture_array(int w, int h, int layers) {
     texer_t texer;
 
     /* init builder */
     texer.atlas_width  = w;
     texer.atlas_height = h;
     texer.i            = 0;
+    texer.seed         = 0;
+    texer.layer        = 0;
+    texer.variant_seed = 0;
+
+    /* no additional targets */
+    texer.targets.height      = NULL;
+    texer.targets.roughness   = NULL;
+    texer.targets.fixed       = NULL;
+    texer.program             = NULL;
+    texer.material.height     = 0.0f;
+    texer.material.roughness  = 0.0f;
+
+    /* row-major, top-down */
+    texer.origin       = 0;
+    texer.pitch        = w;
+    texer.step         = 1;
 
     /* set mask */
     texer.mask.x = 0;
     texer.mask.y = 0;
     texer.mask.w = w;
     texer.mask.h = h;
+    texer.coverage = 1.0f;
+
+    texer.blend    = alpha_blend;
 
     /* init texture */
     texer.tex.width    = w;
     texer.tex.height   = h;
-    texer.tex.rgb      = malloc(w * h * sizeof(color_t));
+    texer.tex.rgb      = calloc(w * h * layers, sizeof(color_t)); /* starts out transparent */
+    texer.tex.flags    = TEXER_FLAG_NONE;
+    texer.tex.layers   = layers;
+
+    return texer;
+}
+
+texer_t texture_flags(texer_t texer, int flags) {
+    int w = texer.atlas_width;
+
+    texer.tex.flags = flags;
+
+    /* flipped: start at the last row and walk rows backwards,
+     * mirrored: start at the last pixel of a row and walk columns backwards */
+    texer.origin = _origin(texer, texer.layer);
+    texer.pitch  = (flags & TEXER_FLAG_FLIP)   ? -w : w;
+    texer.step   = (flags & TEXER_FLAG_MIRROR) ? -1 : 1;
+
+    return texer;
+}
+
+texer_t texture_layer(texer_t texer, uint layer) {
+    texer.layer  = layer;
+    texer.origin = _origin(texer, layer);
+    return texer;
+}
 
+texer_t texture_targets(texer_t texer, int targets) {
+    size_t count = texer.atlas_width * texer.atlas_height * texer.tex.layers;
+    if (targets & TEXER_TARGET_HEIGHT)    { texer.targets.height    = calloc(count, sizeof(float)); }
+    if (targets & TEXER_TARGET_ROUGHNESS) { texer.targets.roughness = calloc(count, sizeof(float)); }
+    if (targets & TEXER_TARGET_FIXED16)   {
+        /* replaces the float colors (half the memory per pixel), the built texture_t has no rgb then */
+        texer.targets.fixed = calloc(count, 4 * sizeof(unsigned short));
+        free(texer.tex.rgb);
+        texer.tex.rgb = NULL;
+    }
     return texer;
 }
 
+void texture_rgba8(texer_t texer, unsigned char* rgba, uint thread_id, uint thread_count) {
+    uint row_size = texer.atlas_width * 4;
+    uint rows     = texer.atlas_height * texer.tex.layers;
+    for (uint row = thread_id; row < rows; row += thread_count) {
+        const unsigned short* src = texer.targets.fixed + row * row_size;
+        unsigned char* dst = rgba + row * row_size;
+        for (uint i = 0; i < row_size; i++) { dst[i] = (src[i] * 255 + TEXER_FIXED_ONE / 2) / TEXER_FIXED_ONE; }
+    }
+}
+
+void texture_normals(texer_t texer, texture_t normals, float strength, uint thread_id, uint thread_count) {
+    int w = texer.atlas_width;
+    int h = texer.atlas_height;
+    if (!texer.targets.height) { return; }
+
+    for (uint layer = 0; layer < texer.tex.layers; layer++) {
+        float* height = texer.targets.height + layer * w * h;
+        for (int y = thread_id; y < h; y += thread_count) {
+            /* clamp to the edge */
+            float* up   = height + max(y - 1, 0)     * w;
+            float* mid  = height + y                 * w;
+            float* down = height + min(y + 1, h - 1) * w;
+            color_t* out = normals.rgb + (layer * h + y) * w;
+
+            for (int x = 0; x < w; x++) {
+                int l = max(x - 1, 0);
+                int r = min(x + 1, w - 1);
+
+                /* 3x3 sobel kernels */
+                float dx = (up[r] + 2.0f * mid[r] + down[r]) - (up[l] + 2.0f * mid[l] + down[l]);
+                float dy = (down[l] + 2.0f * down[x] + down[r]) - (up[l] + 2.0f * up[x] + up[r]);
+
+                float nx = -dx * strength;
+                float ny = -dy * strength;
+                float inv_len = 1.0f / sqrtf(nx * nx + ny * ny + 1.0f);
+
+                /* pack [-1,1] into [0,1] */
+                out[x].r = 0.5f + 0.5f * nx * inv_len;
+                out[x].g = 0.5f + 0.5f * ny * inv_len;
+                out[x].b = 0.5f + 0.5f * inv_len;
+                out[x].a = 1.0f;
+            }
+        }
+    }
+}
+
+void texture_blit(texture_t dst, texture_t src, int x, int y) {
+    _assert_colors(dst);
+    _assert_colors(src);
+    /* clip src to dst */
+    int src_x = max(-x, 0);
+    int src_y = max(-y, 0);
+    int w     = min((int) src.width,  (int) dst.width  - x) - src_x;
+    int h     = min((int) src.height, (int) dst.height - y) - src_y;
+    if (w <= 0 || h <= 0) { return; }
+
+    for (int row = src_y; row < src_y + h; row++) {
+        if (src.flags == dst.flags) {
+            /* same orientation: the span is contiguous in both, starting at its leftmost pixel in memory */
+            int first = (src.flags & TEXER_FLAG_MIRROR) ? (src_x + w - 1) : src_x;
+            color_t* from = src.rgb + texture_index(src, 0, first, row);
+            color_t* to   = dst.rgb + texture_index(dst, 0, first + x, row + y);
+            memcpy(to, from, w * sizeof(color_t));
+        } else {
+            for (int col = src_x; col < src_x + w; col++) {
+                dst.rgb[texture_index(dst, 0, col + x, row + y)] = src.rgb[texture_index(src, 0, col, row)];
+            }
+        }
+    }
+}
+
+texture_t _texture_from_string(const color_t* palette, const char* first, ...) {
+    va_list args;
+
+    /* size, every row is measured only once */
+    uint width  = strlen(first);
+    uint height = 0;
+    va_start(args, first);
+    for (const char* row = first; row != NULL; row = va_arg(args, const char*)) {
+        assert(strlen(row) == width); /* texture needs to be rectangular */
+        height++;
+    }
+    va_end(args);
+
+    texture_t tex = texture(width, height).tex;
+
+    /* decode, one table lookup per character */
+    color_t* out = tex.rgb;
+    va_start(args, first);
+    for (const char* row = first; row != NULL; row = va_arg(args, const char*)) {
+        for (uint x = 0; x < width; x++) {
+            color_t color = palette[(unsigned char) row[x]];
+            *out++ = (color_t) { color.r * color.a, color.g * color.a, color.b * color.a, color.a };
+        }
+    }
+    va_end(args);
+
+    return tex;
+}
+
+/* pointer to the first pixel of a row as seen upright and the stride to the next pixel to the right */
+static color_t* _row(texture_t tex, uint layer, uint y, int* stride) {
+    *stride = (tex.flags & TEXER_FLAG_MIRROR) ? -1 : 1;
+    return tex.rgb + texture_index(tex, layer, 0, y);
+}
+
+static float _filter(int filter, float x) {
+    x = fabsf(x);
+    switch (filter) {
+        case TEXER_FILTER_LANCZOS : {
+            const float pi = 3.14159265f;
+            if (x < 1e-5f) { return 1.0f; }
+            if (x >= 3.0f) { return 0.0f; }
+            return (3.0f * sinf(pi * x) * sinf(pi * x / 3.0f)) / (pi * pi * x * x);
+        } break;
+        default : { return max(1.0f - x, 0.0f); } break; /* tent */
+    }
+}
+
+/* precompute which src pixels contribute to every dst pixel along one axis and by how much.
+ * returns the maximum number of taps, which is the stride of weights */
+static uint _resize_weights(uint src_size, uint dst_size, int filter, int** first, int** count, float** weights) {
+    float scale   = (float) src_size / dst_size;
+    float support = (filter == TEXER_FILTER_LANCZOS) ? 3.0f : 1.0f;
+    float stretch = max(scale, 1.0f); /* widen the filter when downscaling so every src pixel contributes */
+    uint  taps    = (uint) ceilf(support * stretch) * 2 + 1;
+
+    *first   = malloc(dst_size * sizeof(int));
+    *count   = malloc(dst_size * sizeof(int));
+    *weights = calloc(dst_size * taps, sizeof(float));
+
+    for (uint i = 0; i < dst_size; i++) {
+        float center = (i + 0.5f) * scale - 0.5f; /* align pixel centers */
+        int   lo     = max((int) ceilf(center - support * stretch), 0);
+        int   hi     = min((int) floorf(center + support * stretch), (int) src_size - 1);
+        float* w     = *weights + i * taps;
+        float  sum   = 0.0f;
+
+        (*first)[i] = lo;
+        (*count)[i] = min(hi - lo + 1, (int) taps);
+        for (int t = 0; t < (*count)[i]; t++) {
+            w[t] = _filter(filter, (lo + t - center) / stretch);
+            sum += w[t];
+        }
+        for (int t = 0; t < (*count)[i]; t++) { w[t] /= sum; } /* weights at the edges got cut off */
+    }
+
+    return taps;
+}
+
+void texture_resize(texture_t dst, texture_t src, int filter, uint thread_id, uint thread_count) {
+    _assert_colors(dst);
+    _assert_colors(src);
+    int   *first_x, *count_x, *first_y, *count_y;
+    float *weights_x, *weights_y;
+    uint taps_x = _resize_weights(src.width,  dst.width,  filter, &first_x, &count_x, &weights_x);
+    uint taps_y = _resize_weights(src.height, dst.height, filter, &first_y, &count_y, &weights_y);
+
+    /* contiguous band of dst rows, so that neighbouring rows can share horizontally filtered src rows */
+    uint row_begin = (dst.height *  thread_id     ) / thread_count;
+    uint row_end   = (dst.height * (thread_id + 1)) / thread_count;
+    if (row_begin < row_end) {
+        /* src rows needed by this band */
+        uint src_begin = first_y[row_begin];
+        uint src_end   = first_y[row_end - 1] + count_y[row_end - 1];
+        color_t* scratch = malloc((src_end - src_begin) * dst.width * sizeof(color_t));
+
+        for (uint layer = 0; layer < min(src.layers, dst.layers); layer++) {
+            /* first pass: horizontal, src rows -> scratch rows of dst width */
+            for (uint y = src_begin; y < src_end; y++) {
+                int stride;
+                color_t* in  = _row(src, layer, y, &stride);
+                color_t* out = scratch + (y - src_begin) * dst.width;
+                for (uint x = 0; x < dst.width; x++) {
+                    float* w = weights_x + x * taps_x;
+                    color_t* p = in + first_x[x] * stride;
+                    color_t sum = {0, 0, 0, 0};
+                    for (int t = 0; t < count_x[x]; t++, p += stride) {
+                        sum.r += w[t] * p->r; sum.g += w[t] * p->g; sum.b += w[t] * p->b; sum.a += w[t] * p->a;
+                    }
+                    out[x] = sum;
+                }
+            }
+
+            /* second pass: vertical, scratch rows -> dst rows */
+            for (uint y = row_begin; y < row_end; y++) {
+                int stride;
+                color_t* out = _row(dst, layer, y, &stride);
+                float*   w   = weights_y + y * taps_y;
+                for (uint x = 0; x < dst.width; x++) { out[(int) x * stride] = (color_t){0, 0, 0, 0}; }
+                for (int t = 0; t < count_y[y]; t++) {
+                    color_t* in = scratch + (first_y[y] + t - src_begin) * dst.width;
+                    for (uint x = 0; x < dst.width; x++) {
+                        color_t* o = out + (int) x * stride;
+                        o->r += w[t] * in[x].r; o->g += w[t] * in[x].g; o->b += w[t] * in[x].b; o->a += w[t] * in[x].a;
+                    }
+                }
+                /* lanczos over- and undershoots */
+                for (uint x = 0; x < dst.width; x++) {
+                    color_t* o = out + (int) x * stride;
+                    o->r = CLAMP(o->r, 0.0f, 1.0f); o->g = CLAMP(o->g, 0.0f, 1.0f); o->b = CLAMP(o->b, 0.0f, 1.0f); o->a = CLAMP(o->a, 0.0f, 1.0f);
+                }
+            }
+        }
+
+        free(scratch);
+    }
+
+    free(first_x); free(count_x); free(weights_x);
+    free(first_y); free(count_y); free(weights_y);
+}
+
+/* box filter count pixels with a running sum, pixels past the ends are clamped to the edge */
+static void _box_pass(color_t* out, int out_stride, const color_t* in, int in_stride, int count, int radius) {
+    float scale = 1.0f / (2 * radius + 1);
+    color_t sum = {0, 0, 0, 0};
+    for (int i = -radius; i <= radius; i++) {
+        const color_t* c = in + CLAMP(i, 0, count - 1) * in_stride;
+        sum.r += c->r; sum.g += c->g; sum.b += c->b; sum.a += c->a;
+    }
+    for (int i = 0; i < count; i++) {
+        color_t* o = out + i * out_stride;
+        o->r = sum.r * scale; o->g = sum.g * scale; o->b = sum.b * scale; o->a = sum.a * scale;
+
+        /* slide the window one pixel */
+        const color_t* leaving  = in + max(i - radius, 0)            * in_stride;
+        const color_t* entering = in + min(i + radius + 1, count - 1) * in_stride;
+        sum.r += entering->r - leaving->r; sum.g += entering->g - leaving->g;
+        sum.b += entering->b - leaving->b; sum.a += entering->a - leaving->a;
+    }
+}
+
+/* one or more box passes with the given radii, first along rows then along columns */
+static void _blur(texture_t dst, texture_t src, int x, int y, int w, int h, const int* radii, uint passes, uint thread_id, uint thread_count) {
+    _assert_colors(dst);
+    _assert_colors(src);
+    /* clip the rect to both textures */
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    w = min(w, (int) min(src.width,  dst.width)  - x);
+    h = min(h, (int) min(src.height, dst.height) - y);
+    if (w <= 0 || h <= 0) { return; }
+
+    int margin = 0;
+    for (uint pass = 0; pass < passes; pass++) { margin += radii[pass]; }
+
+    /* fixed blocks of rows, each with the rows within reach of the vertical passes, so that the running sums always
+     * start at the same rows and the result doesn't depend on the thread count. every thread blurs a contiguous
+     * run of blocks and threads never share scratch */
+    int block  = max(128, 8 * margin); /* the margin is recomputed per block, keep that overhead small */
+    int blocks = (h + block - 1) / block;
+    int first  = (blocks *  (int) thread_id     ) / (int) thread_count;
+    int last   = (blocks * ((int) thread_id + 1)) / (int) thread_count;
+    if (first >= last) { return; }
+
+    color_t* scratch = malloc(2 * (min(block, h) + 2 * margin) * w * sizeof(color_t));
+
+    for (uint layer = 0; layer < min(src.layers, dst.layers); layer++) {
+        for (int b = first; b < last; b++) {
+            int row_begin = b * block;
+            int row_end   = min(row_begin + block, h);
+            int lo   = max(row_begin - margin, 0);
+            int hi   = min(row_end   + margin, h);
+            int rows = hi - lo;
+
+            color_t* cur   = scratch;
+            color_t* other = scratch + rows * w;
+
+            /* horizontal passes, row by row */
+            for (int row = 0; row < rows; row++) {
+                int stride;
+                color_t* in = _row(src, layer, y + lo + row, &stride) + x * stride;
+                color_t* a  = cur   + row * w;
+                color_t* c  = other + row * w;
+                for (uint pass = 0; pass < passes; pass++) {
+                    if (pass == 0) { _box_pass(a, 1, in, stride, w, radii[pass]); }
+                    else           { _box_pass(c, 1, a,  1,      w, radii[pass]); color_t* t = a; a = c; c = t; }
+                }
+                if (a != cur + row * w) { memcpy(cur + row * w, a, w * sizeof(color_t)); }
+            }
+
+            /* vertical passes, column by column. NOTE: the rows next to an inner edge of the block get clamped
+             * to the wrong value, but that error only travels one radius per pass and stays within the margin */
+            for (uint pass = 0; pass < passes; pass++) {
+                for (int col = 0; col < w; col++) { _box_pass(other + col, w, cur + col, w, rows, radii[pass]); }
+                color_t* t = cur; cur = other; other = t;
+            }
+
+            for (int row = row_begin; row < row_end; row++) {
+                int stride;
+                color_t* out = _row(dst, layer, y + row, &stride) + x * stride;
+                color_t* in  = cur + (row - lo) * w;
+                for (int col = 0; col < w; col++) { out[col * stride] = in[col]; }
+            }
+        }
+    }
+
+    free(scratch);
+}
+
+void texture_box_blur(texture_t dst, texture_t src, int x, int y, int w, int h, int radius, uint thread_id, uint thread_count) {
+    int radii[1] = { max(radius, 0) };
+    _blur(dst, src, x, y, w, h, radii, 1, thread_id, thread_count);
+}
+
+void texture_gaussian_blur(texture_t dst, texture_t src, int x, int y, int w, int h, float sigma, uint thread_id, uint thread_count) {
+    /* widths of three boxes whose combined variance is closest to sigma^2, see "Fast Almost-Gaussian Filtering" (Kovesi) */
+    const int n = 3;
+    int lower = (int) floorf(sqrtf(12.0f * sigma * sigma / n + 1.0f));
+    if (lower % 2 == 0) { lower -= 1; }
+    int m = (int) roundf((12.0f * sigma * sigma - n * lower * lower - 4 * n * lower - 3 * n) / (-4.0f * lower - 4.0f));
+
+    int radii[3];
+    for (int pass = 0; pass < n; pass++) { radii[pass] = max(((pass < m) ? lower : lower + 2) / 2, 0); }
+    _blur(dst, src, x, y, w, h, radii, n, thread_id, thread_count);
+}
+
+/* compare one tile of two layers row by row, x/y/w/h are in unflipped, unmirrored coordinates */
+static int _tile_equal(texture_t t, uint layer_a, uint layer_b, uint x, uint y, uint w, uint h) {
+    if (t.flags & TEXER_FLAG_MIRROR) { x = t.width - (x + w); }
+    for (uint row = y; row < y + h; row++) {
+        uint storage_row = (t.flags & TEXER_FLAG_FLIP) ? (t.height - row - 1) : row;
+        color_t* a = t.rgb + (layer_a * t.height + storage_row) * t.width + x;
+        color_t* b = t.rgb + (layer_b * t.height + storage_row) * t.width + x;
+        if (memcmp(a, b, w * sizeof(color_t)) != 0) { return 0; }
+    }
+    return 1;
+}
+
+uint texture_dedupe_tiles(texture_t frames, uint tile_w, uint tile_h, uint* table) {
+    _assert_colors(frames);
+    uint tiles_x    = (frames.width  + tile_w - 1) / tile_w;
+    uint tiles_y    = (frames.height + tile_h - 1) / tile_h;
+    uint tile_count = tiles_x * tiles_y;
+    uint unique     = 0;
+
+    for (uint frame = 0; frame < frames.layers; frame++) {
+        for (uint tile = 0; tile < tile_count; tile++) {
+            uint x = (tile % tiles_x) * tile_w;
+            uint y = (tile / tiles_x) * tile_h;
+            uint w = min(tile_w, frames.width  - x);
+            uint h = min(tile_h, frames.height - y);
+
+            /* NOTE: only the previous frame is compared against, so this is O(frames) and not O(frames^2) */
+            uint* entry = &table[frame * tile_count + tile];
+            if (frame > 0 && _tile_equal(frames, frame, frame - 1, x, y, w, h)) {
+                *entry = table[(frame - 1) * tile_count + tile];
+            } else {
+                *entry = frame;
+                unique++;
+            }
+        }
+    }
+
+    return unique;
+}
+
+static unsigned short _pack565(const float* c) {
+    return (unsigned short) (((int) (c[0] * 31.0f / 255.0f + 0.5f) << 11) | ((int) (c[1] * 63.0f / 255.0f + 0.5f) << 5) | (int) (c[2] * 31.0f / 255.0f + 0.5f));
+}
+static void _unpack565(unsigned short c, float* out) {
+    uint r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    out[0] = (float) ((r << 3) | (r >> 2));
+    out[1] = (float) ((g << 2) | (g >> 4));
+    out[2] = (float) ((b << 3) | (b >> 2));
+}
+
+/* color endpoints along the principal axis of the block, then the closest of the four palette entries per pixel */
+static void _encode_bc1(float px[16][4], unsigned char* out) {
+    float mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++) { mean[0] += px[i][0] / 16.0f; mean[1] += px[i][1] / 16.0f; mean[2] += px[i][2] / 16.0f; }
+
+    /* covariance, then a few rounds of power iteration for its largest eigenvector */
+    float cov[6] = {0, 0, 0, 0, 0, 0};
+    float box_lo[3] = {255, 255, 255}, box_hi[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++) {
+        float r = px[i][0] - mean[0], g = px[i][1] - mean[1], b = px[i][2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+        for (int c = 0; c < 3; c++) { box_lo[c] = min(box_lo[c], px[i][c]); box_hi[c] = max(box_hi[c], px[i][c]); }
+    }
+
+    /* NOTE: a fixed start like {1,1,1} has no component along spreads orthogonal to it (a red/green checker), so
+     * start from the covariance column with the largest variance, or the bounding box diagonal without one */
+    float axis[3] = {box_hi[0] - box_lo[0], box_hi[1] - box_lo[1], box_hi[2] - box_lo[2]};
+    static const int columns[3][3] = { {0, 1, 2}, {1, 3, 4}, {2, 4, 5} }; /* cov entries per column */
+    int column = cov[0] >= cov[3] && cov[0] >= cov[5] ? 0 : cov[3] >= cov[5] ? 1 : 2;
+    if (cov[columns[column][column]] > 0.0f) {
+        for (int c = 0; c < 3; c++) { axis[c] = cov[columns[column][c]]; }
+    }
+    if (axis[0] == 0.0f && axis[1] == 0.0f && axis[2] == 0.0f) {
+        axis[0] = axis[1] = axis[2] = 1.0f; /* flat block, any axis will do */
+    }
+    for (int iteration = 0; iteration < 4; iteration++) {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float length = max(fabsf(x), max(fabsf(y), fabsf(z)));
+        if (!(length > 0.0f)) { break; } /* keep the last axis */
+        axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+    }
+
+    /* extent of the block along the axis */
+    float lo = 1e20f, hi = -1e20f;
+    for (int i = 0; i < 16; i++) {
+        float t = (px[i][0] - mean[0]) * axis[0] + (px[i][1] - mean[1]) * axis[1] + (px[i][2] - mean[2]) * axis[2];
+        lo = min(lo, t);
+        hi = max(hi, t);
+    }
+    float length2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float end0[3], end1[3];
+    for (int c = 0; c < 3; c++) {
+        end0[c] = CLAMP(mean[c] + axis[c] * hi / length2, 0.0f, 255.0f);
+        end1[c] = CLAMP(mean[c] + axis[c] * lo / length2, 0.0f, 255.0f);
+    }
+
+    /* c0 > c1 selects the four color mode */
+    unsigned short c0 = _pack565(end0), c1 = _pack565(end1);
+    if (c0 < c1) { unsigned short t = c0; c0 = c1; c1 = t; }
+
+    float palette[4][3];
+    _unpack565(c0, palette[0]);
+    _unpack565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+
+    uint indices = 0;
+    if (c0 != c1) {
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            float best_distance = 1e20f;
+            for (int p = 0; p < 4; p++) {
+                float dr = px[i][0] - palette[p][0], dg = px[i][1] - palette[p][1], db = px[i][2] - palette[p][2];
+                float distance = dr * dr + dg * dg + db * db;
+                if (distance < best_distance) { best_distance = distance; best = p; }
+            }
+            indices |= (uint) best << (2 * i);
+        }
+    }
+
+    out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+    for (int i = 0; i < 4; i++) { out[4 + i] = (indices >> (8 * i)) & 0xFF; }
+}
+
+/* alpha endpoints are the extremes of the block, 3 bit index per pixel into eight interpolated values */
+static void _encode_bc3_alpha(float px[16][4], unsigned char* out) {
+    float lo = 255.0f, hi = 0.0f;
+    for (int i = 0; i < 16; i++) { lo = min(lo, px[i][3]); hi = max(hi, px[i][3]); }
+    int a0 = (int) (hi + 0.5f), a1 = (int) (lo + 0.5f);
+
+    unsigned long long indices = 0;
+    if (a0 > a1) {
+        /* a0 > a1 selects eight values: a0, a1 and six steps from a0 to a1 */
+        static const int order[8] = { 0, 2, 3, 4, 5, 6, 7, 1 }; /* index for 0/7 to 7/7 of the way to a1 */
+        for (int i = 0; i < 16; i++) {
+            int steps = (int) ((a0 - px[i][3]) * 7.0f / (a0 - a1) + 0.5f);
+            indices |= (unsigned long long) order[CLAMP(steps, 0, 7)] << (3 * i);
+        }
+    }
+
+    out[0] = (unsigned char) a0;
+    out[1] = (unsigned char) a1;
+    for (int i = 0; i < 6; i++) { out[2 + i] = (indices >> (8 * i)) & 0xFF; }
+}
+
+size_t texture_compressed_size(texture_t tex, int format) {
+    size_t block_count = (size_t) ((tex.width + 3) / 4) * ((tex.height + 3) / 4) * tex.layers;
+    return block_count * ((format == TEXER_BC3) ? 16 : 8);
+}
+
+void texture_compress(texture_t tex, int format, unsigned char* blocks, uint thread_id, uint thread_count) {
+    _assert_colors(tex);
+    uint blocks_x   = (tex.width  + 3) / 4;
+    uint blocks_y   = (tex.height + 3) / 4;
+    uint block_size = (format == TEXER_BC3) ? 16 : 8;
+
+    for (uint layer = 0; layer < tex.layers; layer++) {
+        for (uint block_y = thread_id; block_y < blocks_y; block_y += thread_count) {
+            for (uint block_x = 0; block_x < blocks_x; block_x++) {
+                /* gather in 0..255, straight from storage */
+                float px[16][4];
+                for (int i = 0; i < 16; i++) {
+                    uint x = min(block_x * 4 + i % 4, tex.width  - 1);
+                    uint y = min(block_y * 4 + i / 4, tex.height - 1);
+                    color_t c = tex.rgb[(layer * tex.height + y) * tex.width + x];
+                    px[i][0] = CLAMP(c.r, 0.0f, 1.0f) * 255.0f;
+                    px[i][1] = CLAMP(c.g, 0.0f, 1.0f) * 255.0f;
+                    px[i][2] = CLAMP(c.b, 0.0f, 1.0f) * 255.0f;
+                    px[i][3] = CLAMP(c.a, 0.0f, 1.0f) * 255.0f;
+                }
+
+                unsigned char* out = blocks + ((layer * blocks_y + block_y) * blocks_x + block_x) * block_size;
+                if (format == TEXER_BC3) { _encode_bc3_alpha(px, out); out += 8; }
+                _encode_bc1(px, out);
+            }
+        }
+    }
+}
+
+/* growable output of the encoders, deflate writes bits starting at the least significant one */
+typedef struct texer_stream_t {
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+    uint bits;
+    uint bit_count;
+} texer_stream_t;
+
+static void _put(texer_stream_t* s, const void* bytes, size_t count) {
+    if (s->size + count > s->capacity) {
+        s->capacity = max(2 * s->capacity, s->size + count + 4096);
+        s->data     = realloc(s->data, s->capacity);
+    }
+    memcpy(s->data + s->size, bytes, count);
+    s->size += count;
+}
+static void _put_byte(texer_stream_t* s, unsigned char byte) { _put(s, &byte, 1); }
+static void _put_u32(texer_stream_t* s, uint value) { /* big endian */
+    unsigned char bytes[4] = { value >> 24, (value >> 16) & 0xFF, (value >> 8) & 0xFF, value & 0xFF };
+    _put(s, bytes, 4);
+}
+static void _put_bits(texer_stream_t* s, uint value, uint count) {
+    s->bits      |= value << s->bit_count;
+    s->bit_count += count;
+    while (s->bit_count >= 8) { _put_byte(s, s->bits & 0xFF); s->bits >>= 8; s->bit_count -= 8; }
+}
+static void _flush_bits(texer_stream_t* s) {
+    if (s->bit_count > 0) { _put_byte(s, s->bits & 0xFF); }
+    s->bits = 0; s->bit_count = 0;
+}
+
+/* 8-bit RGBA of one upright row, layers stacked vertically */
+static void _rgba8_row(texture_t tex, uint row, unsigned char* out) {
+    for (uint x = 0; x < tex.width; x++) {
+        color_t c = tex.rgb[texture_index(tex, row / tex.height, x, row % tex.height)];
+        out[4 * x + 0] = (unsigned char) (CLAMP(c.r, 0.0f, 1.0f) * 255.0f + 0.5f);
+        out[4 * x + 1] = (unsigned char) (CLAMP(c.g, 0.0f, 1.0f) * 255.0f + 0.5f);
+        out[4 * x + 2] = (unsigned char) (CLAMP(c.b, 0.0f, 1.0f) * 255.0f + 0.5f);
+        out[4 * x + 3] = (unsigned char) (CLAMP(c.a, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+}
+
+/* QOI ops for rows [begin, end). the decoder carries its color index over from the previous chunk, which this
+ * thread does not know, so the index starts out with impossible values and only refers to colors of this chunk */
+static void _encode_qoi(texture_t tex, uint begin, uint end, texer_stream_t* s) {
+    unsigned long long index[64];
+    for (int i = 0; i < 64; i++) { index[i] = ~0ULL; }
+
+    unsigned char* row = malloc(4 * tex.width);
+    unsigned char prev[4] = { 0, 0, 0, 255 };
+    if (begin > 0) { _rgba8_row(tex, begin - 1, row); memcpy(prev, row + 4 * (tex.width - 1), 4); } /* last pixel of the chunk before */
+
+    uint run = 0;
+    for (uint y = begin; y < end; y++) {
+        _rgba8_row(tex, y, row);
+        for (uint x = 0; x < tex.width; x++) {
+            unsigned char* px = row + 4 * x;
+            if (memcmp(px, prev, 4) == 0) {
+                if (++run == 62) { _put_byte(s, 0xC0 | (run - 1)); run = 0; }
+                continue;
+            }
+            if (run > 0) { _put_byte(s, 0xC0 | (run - 1)); run = 0; }
+
+            uint color = (uint) px[0] << 24 | (uint) px[1] << 16 | (uint) px[2] << 8 | px[3];
+            uint hash  = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+            if (index[hash] == color) {
+                _put_byte(s, hash);
+            } else {
+                index[hash] = color;
+                int dr = px[0] - prev[0], dg = px[1] - prev[1], db = px[2] - prev[2];
+                dr = (signed char) dr; dg = (signed char) dg; db = (signed char) db; /* differences wrap around */
+                if (px[3] != prev[3]) {
+                    unsigned char op[5] = { 0xFF, px[0], px[1], px[2], px[3] };
+                    _put(s, op, 5);
+                } else if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    _put_byte(s, 0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                } else if (dg >= -32 && dg <= 31 && dr - dg >= -8 && dr - dg <= 7 && db - dg >= -8 && db - dg <= 7) {
+                    _put_byte(s, 0x80 | (dg + 32));
+                    _put_byte(s, (dr - dg + 8) << 4 | (db - dg + 8));
+                } else {
+                    unsigned char op[4] = { 0xFE, px[0], px[1], px[2] };
+                    _put(s, op, 4);
+                }
+            }
+            memcpy(prev, px, 4);
+        }
+    }
+    if (run > 0) { _put_byte(s, 0xC0 | (run - 1)); } /* runs never continue into the next chunk */
+
+    free(row);
+}
+
+static uint _crc32(uint crc, const unsigned char* data, size_t size) {
+    /* reflected 0xEDB88320 polynomial, precomputed so that threads never have to fill it */
+    static const uint table[256] = {
+        0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
+        0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
+        0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+        0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
+        0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
+        0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+        0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
+        0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
+        0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+        0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
+        0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
+        0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+        0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
+        0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
+        0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+        0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
+        0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
+        0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+        0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
+        0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
+        0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+        0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
+        0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
+        0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+        0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
+        0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
+        0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+        0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
+        0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
+        0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+        0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
+        0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) { crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8); }
+    return ~crc;
+}
+
+static uint _adler32(uint adler, const unsigned char* data, size_t size) {
+    uint a = adler & 0xFFFF, b = adler >> 16;
+    for (size_t i = 0; i < size; i++) { a = (a + data[i]) % 65521; b = (b + a) % 65521; }
+    return (b << 16) | a;
+}
+/* adler-32 of the concatenation, given the checksums of both parts */
+static uint _adler32_combine(uint first, uint second, size_t second_size) {
+    unsigned long long a1 = first & 0xFFFF, b1 = first >> 16, a2 = second & 0xFFFF, b2 = second >> 16;
+    unsigned long long a  = (a1 + a2 + 65521 - 1) % 65521;
+    unsigned long long b  = (b1 + b2 + (second_size % 65521) * (a1 + 65521 - 1)) % 65521;
+    return (uint) ((b << 16) | a);
+}
+
+/* one fixed huffman code, huffman codes go most significant bit first */
+static void _put_code(texer_stream_t* s, uint code, uint length) {
+    uint reversed = 0;
+    for (uint i = 0; i < length; i++) { reversed = (reversed << 1) | ((code >> i) & 1); }
+    _put_bits(s, reversed, length);
+}
+static void _put_symbol(texer_stream_t* s, uint symbol) {
+    if      (symbol < 144) { _put_code(s, 0x30  + symbol,       8); }
+    else if (symbol < 256) { _put_code(s, 0x190 + symbol - 144, 9); }
+    else if (symbol < 280) { _put_code(s,         symbol - 256, 7); }
+    else                   { _put_code(s, 0xC0  + symbol - 280, 8); }
+}
+
+#define TEXER_DEFLATE_WINDOW     32768
+#define TEXER_DEFLATE_HASH_BITS  14
+static inline uint _deflate_hash(const unsigned char* p) { return (((uint) p[0] << 16 | (uint) p[1] << 8 | p[2]) * 2654435761u) >> (32 - TEXER_DEFLATE_HASH_BITS); }
+
+/* data[start, end) as one fixed huffman block, greedy matching with a single candidate per hash. matches may
+ * reach back into data[0, start). table holds the last position of every hash, -1 if none */
+static void _deflate_block(texer_stream_t* s, const unsigned char* data, size_t start, size_t end, int* table) {
+    static const unsigned short length_base[29]  = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+    static const unsigned char  length_extra[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+    static const unsigned short distance_base[30]  = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+    static const unsigned char  distance_extra[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+
+    _put_bits(s, 0, 1); /* not the final block */
+    _put_bits(s, 1, 2); /* fixed huffman codes */
+
+    size_t i = start;
+    while (i < end) {
+        uint length = 0, distance = 0;
+        if (i + 3 <= end) {
+            uint hash     = _deflate_hash(data + i);
+            int candidate = table[hash];
+            table[hash]   = (int) i;
+            if (candidate >= 0 && i - candidate <= TEXER_DEFLATE_WINDOW) {
+                uint limit = (uint) min(end - i, 258);
+                while (length < limit && data[candidate + length] == data[i + length]) { length++; }
+                distance = (uint) (i - candidate);
+            }
+        }
+
+        if (length >= 3) {
+            int l = 28; while (length_base[l]   > length)   { l--; }
+            int d = 29; while (distance_base[d] > distance) { d--; }
+            _put_symbol(s, 257 + l);
+            _put_bits(s, length - length_base[l], length_extra[l]);
+            _put_code(s, d, 5);
+            _put_bits(s, distance - distance_base[d], distance_extra[d]);
+
+            /* remember the positions inside of the match too */
+            for (size_t j = i + 1; j < i + length && j + 3 <= end; j++) { table[_deflate_hash(data + j)] = (int) j; }
+            i += length;
+        } else {
+            _put_symbol(s, data[i]);
+            i++;
+        }
+    }
+
+    _put_symbol(s, 256); /* end of block */
+}
+
+static inline int _paeth(int a, int b, int c) {
+    int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+}
+
+/* png scanlines for rows [begin, end) as an IDAT chunk with a deflate stream that ends byte aligned (but not
+ * final), so the chunks of all threads can be concatenated. compressed in segments, only a window's worth of
+ * scanlines is kept around */
+static void _encode_png(texture_t tex, uint begin, uint end, uint thread_id, texer_stream_t* s, texer_chunk_t* chunk) {
+    size_t line     = 1 + 4 * (size_t) tex.width;
+    size_t segment  = max((size_t) 65536 / line, 1) * line;
+    unsigned char* raw  = malloc(TEXER_DEFLATE_WINDOW + segment);
+    unsigned char* prev = calloc(4 * tex.width, 1);
+    unsigned char* cur  = malloc(4 * tex.width);
+    unsigned char* candidate = malloc(line);
+    int* table          = malloc(sizeof(int) << TEXER_DEFLATE_HASH_BITS);
+    for (uint i = 0; i < (1u << TEXER_DEFLATE_HASH_BITS); i++) { table[i] = -1; }
+    if (begin > 0) { _rgba8_row(tex, begin - 1, prev); } /* filters look at the row above, even if another thread encodes it */
+
+    _put_u32(s, 0); /* length, filled in at the end */
+    _put(s, "IDAT", 4);
+    if (thread_id == 0) { _put_byte(s, 0x78); _put_byte(s, 0x01); } /* zlib header, fastest compression */
+
+    chunk->checksum = 1;
+    chunk->raw_size = 0;
+    size_t history  = 0;
+    for (uint y = begin; y < end; ) {
+        /* filter as many rows as fit into the segment, picking the filter with the smallest sum of magnitudes */
+        size_t size = 0;
+        for (; y < end && size < segment; y++, size += line) {
+            _rgba8_row(tex, y, cur);
+            unsigned char* out = raw + history + size;
+            uint best_sum = ~0u;
+            for (int filter = 0; filter < 5; filter++) {
+                uint sum = 0;
+                candidate[0] = (unsigned char) filter;
+                for (uint i = 0; i < 4 * tex.width; i++) {
+                    int a = (i >= 4) ? cur[i - 4] : 0, b = prev[i], c = (i >= 4) ? prev[i - 4] : 0;
+                    int predicted = (filter == 1) ? a : (filter == 2) ? b : (filter == 3) ? (a + b) / 2 : (filter == 4) ? _paeth(a, b, c) : 0;
+                    candidate[1 + i] = (unsigned char) (cur[i] - predicted);
+                    sum += abs((signed char) candidate[1 + i]);
+                }
+                if (sum < best_sum) { best_sum = sum; memcpy(out, candidate, line); }
+            }
+            unsigned char* t = prev; prev = cur; cur = t;
+        }
+
+        chunk->checksum  = _adler32_combine(chunk->checksum, _adler32(1, raw + history, size), size);
+        chunk->raw_size += size;
+        _deflate_block(s, raw, history, history + size, table);
+
+        /* keep the last window of bytes for the next segment to match against */
+        size_t total = history + size;
+        size_t keep  = min(total, (size_t) TEXER_DEFLATE_WINDOW);
+        size_t shift = total - keep;
+        memmove(raw, raw + shift, keep);
+        history = keep;
+        for (uint i = 0; i < (1u << TEXER_DEFLATE_HASH_BITS); i++) { table[i] = (table[i] >= (int) shift) ? table[i] - (int) shift : -1; }
+    }
+
+    /* empty stored block to align to a byte boundary */
+    _put_bits(s, 0, 3);
+    _flush_bits(s);
+    unsigned char empty[4] = { 0x00, 0x00, 0xFF, 0xFF };
+    _put(s, empty, 4);
+
+    /* patch the length, crc covers type and data */
+    uint length = (uint) (s->size - 8);
+    unsigned char bytes[4] = { length >> 24, (length >> 16) & 0xFF, (length >> 8) & 0xFF, length & 0xFF };
+    memcpy(s->data, bytes, 4);
+    _put_u32(s, _crc32(0, s->data + 4, s->size - 4));
+
+    free(raw); free(prev); free(cur); free(candidate); free(table);
+}
+
+texer_chunk_t texture_encode(texture_t tex, int format, uint thread_id, uint thread_count) {
+    _assert_colors(tex);
+    uint rows  = tex.height * tex.layers;
+    uint begin = (uint) (((unsigned long long) rows *  thread_id     ) / thread_count);
+    uint end   = (uint) (((unsigned long long) rows * (thread_id + 1)) / thread_count);
+
+    texer_chunk_t  chunk = {0};
+    texer_stream_t s     = {0};
+    switch (format) {
+        case TEXER_IMAGE_QOI : { _encode_qoi(tex, begin, end, &s); } break;
+        case TEXER_IMAGE_PNG : { _encode_png(tex, begin, end, thread_id, &s, &chunk); } break;
+    }
+    chunk.data = s.data;
+    chunk.size = s.size;
+    return chunk;
+}
+
+unsigned char* texture_join(texture_t tex, int format, texer_chunk_t* chunks, uint count, size_t* size) {
+    texer_stream_t s = {0};
+    uint rows = tex.height * tex.layers;
+
+    switch (format) {
+        case TEXER_IMAGE_QOI : {
+            _put(&s, "qoif", 4);
+            _put_u32(&s, tex.width);
+            _put_u32(&s, rows);
+            _put_byte(&s, 4); /* rgba */
+            _put_byte(&s, 0); /* srgb */
+            for (uint i = 0; i < count; i++) { _put(&s, chunks[i].data, chunks[i].size); free(chunks[i].data); }
+            unsigned char end[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+            _put(&s, end, 8);
+        } break;
+
+        case TEXER_IMAGE_PNG : {
+            _put(&s, "\x89PNG\r\n\x1a\n", 8);
+
+            unsigned char header[17] = { 'I', 'H', 'D', 'R' };
+            for (int i = 0; i < 4; i++) { header[4 + i] = (tex.width >> (24 - 8 * i)) & 0xFF; header[8 + i] = (rows >> (24 - 8 * i)) & 0xFF; }
+            header[12] = 8; /* bits per channel */
+            header[13] = 6; /* rgba */
+            _put_u32(&s, 13);
+            _put(&s, header, 17);
+            _put_u32(&s, _crc32(0, header, 17));
+
+            uint adler = 1;
+            for (uint i = 0; i < count; i++) {
+                _put(&s, chunks[i].data, chunks[i].size);
+                adler = _adler32_combine(adler, chunks[i].checksum, chunks[i].raw_size);
+                free(chunks[i].data);
+            }
+
+            /* last IDAT: an empty final block and the checksum of the whole zlib stream */
+            unsigned char last[10] = { 'I', 'D', 'A', 'T', 0x03, 0x00, adler >> 24, (adler >> 16) & 0xFF, (adler >> 8) & 0xFF, adler & 0xFF };
+            _put_u32(&s, 6);
+            _put(&s, last, 10);
+            _put_u32(&s, _crc32(0, last, 10));
+
+            _put_u32(&s, 0);
+            _put(&s, "IEND", 4);
+            _put_u32(&s, _crc32(0, (const unsigned char*) "IEND", 4));
+        } break;
+    }
+
+    *size = s.size;
+    return s.data;
+}
+
+#ifdef TEXER_PIPELINE
+#include <stdatomic.h>
+#include <sched.h>  // for sched_yield
+
+/* bounded multi-producer multi-consumer queue (Vyukov). every cell has a sequence number that tells
+ * whether it is ready to be written (== position) or read (== position + 1) in the current lap */
+typedef struct texer_cell_t {
+    atomic_size_t sequence;
+    void* item;
+} texer_cell_t;
+typedef struct texer_queue_t {
+    texer_cell_t* cells;
+    size_t mask; /* capacity - 1, capacity is a power of two */
+    atomic_size_t head;
+    atomic_size_t tail;
+} texer_queue_t;
+
+struct texer_pipeline_t {
+    uint          stage_count;
+    texer_stage_t stages[TEXER_PIPELINE_MAX_STAGES];
+    void*         user[TEXER_PIPELINE_MAX_STAGES];
+    texer_queue_t queues[TEXER_PIPELINE_MAX_STAGES]; /* in front of every stage */
+    atomic_size_t pending; /* pushed, but not through the last stage yet */
+    atomic_int    closed;
+};
+
+static int _queue_push(texer_queue_t* q, void* item) {
+    size_t position = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    texer_cell_t* cell;
+    for (;;) {
+        cell = &q->cells[position & q->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        ptrdiff_t diff  = (ptrdiff_t) sequence - (ptrdiff_t) position;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) { break; }
+        } else if (diff < 0) {
+            return 0; /* full */
+        } else {
+            position = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        }
+    }
+    cell->item = item;
+    atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    return 1;
+}
+
+static int _queue_pop(texer_queue_t* q, void** item) {
+    size_t position = atomic_load_explicit(&q->head, memory_order_relaxed);
+    texer_cell_t* cell;
+    for (;;) {
+        cell = &q->cells[position & q->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        ptrdiff_t diff  = (ptrdiff_t) sequence - (ptrdiff_t) (position + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->head, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) { break; }
+        } else if (diff < 0) {
+            return 0; /* empty */
+        } else {
+            position = atomic_load_explicit(&q->head, memory_order_relaxed);
+        }
+    }
+    *item = cell->item;
+    atomic_store_explicit(&cell->sequence, position + q->mask + 1, memory_order_release); /* ready to be written in the next lap */
+    return 1;
+}
+
+static int _pipeline_run_one(texer_pipeline_t* p, uint first_stage);
+
+/* run the item through stage and hand it to the next one. while the next queue is full, work on the
+ * stages behind it instead of waiting, so threads can never all be stuck pushing */
+static void _pipeline_process(texer_pipeline_t* p, uint stage, void* item) {
+    item = p->stages[stage](item, p->user[stage]);
+    if (item && stage + 1 < p->stage_count) {
+        while (!_queue_push(&p->queues[stage + 1], item)) {
+            if (!_pipeline_run_one(p, stage + 1)) { sched_yield(); }
+        }
+        return;
+    }
+    atomic_fetch_sub(&p->pending, 1); /* dropped or done */
+}
+
+/* process one item of the latest stage that has one, returns 0 if all queues from first_stage on are empty */
+static int _pipeline_run_one(texer_pipeline_t* p, uint first_stage) {
+    for (uint stage = p->stage_count; stage-- > first_stage; ) {
+        void* item;
+        if (_queue_pop(&p->queues[stage], &item)) {
+            _pipeline_process(p, stage, item);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+texer_pipeline_t* texer_pipeline(uint capacity) {
+    texer_pipeline_t* p = calloc(1, sizeof(texer_pipeline_t));
+    size_t size = 1;
+    while (size < max(capacity, 2)) { size *= 2; }
+
+    for (uint stage = 0; stage < TEXER_PIPELINE_MAX_STAGES; stage++) {
+        texer_queue_t* q = &p->queues[stage];
+        q->cells = malloc(size * sizeof(texer_cell_t));
+        q->mask  = size - 1;
+        for (size_t i = 0; i < size; i++) { atomic_init(&q->cells[i].sequence, i); }
+        atomic_init(&q->head, 0);
+        atomic_init(&q->tail, 0);
+    }
+    atomic_init(&p->pending, 0);
+    atomic_init(&p->closed, 0);
+    return p;
+}
+
+void texer_pipeline_stage(texer_pipeline_t* p, texer_stage_t stage, void* user) {
+    assert(p->stage_count < TEXER_PIPELINE_MAX_STAGES);
+    p->stages[p->stage_count] = stage;
+    p->user[p->stage_count]   = user;
+    p->stage_count++;
+}
+
+void texer_pipeline_push(texer_pipeline_t* p, void* item) {
+    atomic_fetch_add(&p->pending, 1); /* before the item becomes visible, so workers can't see an empty pipeline */
+    while (!_queue_push(&p->queues[0], item)) {
+        if (!_pipeline_run_one(p, 0)) { sched_yield(); }
+    }
+}
+
+void texer_pipeline_close(texer_pipeline_t* p) {
+    atomic_store(&p->closed, 1);
+}
+
+void texer_pipeline_work(texer_pipeline_t* p) {
+    for (;;) {
+        if (_pipeline_run_one(p, 0)) { continue; }
+        if (atomic_load(&p->closed) && atomic_load(&p->pending) == 0) { return; }
+        sched_yield();
+    }
+}
+
+void texer_pipeline_free(texer_pipeline_t* p) {
+    for (uint stage = 0; stage < TEXER_PIPELINE_MAX_STAGES; stage++) { free(p->queues[stage].cells); }
+    free(p);
+}
+#endif
+
+/* 64-bit FNV-1a over the tile, a word at a time. x/y/w/h are in storage order */
+static unsigned long long _hash_tile(texture_t t, uint layer, uint x, uint y, uint w, uint h) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (uint row = y; row < y + h; row++) {
+        const unsigned char* bytes = (const unsigned char*) (t.rgb + (layer * t.height + row) * t.width + x);
+        for (uint i = 0; i < w * sizeof(color_t); i += sizeof(uint)) {
+            uint word;
+            memcpy(&word, bytes + i, sizeof(uint));
+            hash = (hash ^ word) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+uint texture_dirty_tiles(texture_t tex, uint tile_w, uint tile_h, unsigned long long* hashes, uint* dirty) {
+    _assert_colors(tex);
+    uint tiles_x    = (tex.width  + tile_w - 1) / tile_w;
+    uint tiles_y    = (tex.height + tile_h - 1) / tile_h;
+    uint tile_count = tiles_x * tiles_y;
+    uint count      = 0;
+
+    for (uint layer = 0; layer < tex.layers; layer++) {
+        for (uint tile = 0; tile < tile_count; tile++) {
+            uint x = (tile % tiles_x) * tile_w;
+            uint y = (tile / tiles_x) * tile_h;
+            unsigned long long hash = _hash_tile(tex, layer, x, y, min(tile_w, tex.width - x), min(tile_h, tex.height - y));
+
+            /* NOTE: the first call reports every tile, the zeroed hashes never match */
+            uint index = layer * tile_count + tile;
+            if (hashes[index] != hash) {
+                hashes[index]  = hash;
+                dirty[count++] = index;
+            }
+        }
+    }
+
+    return count;
+}
+
+texer_virtual_t texer_virtual(uint width, uint height, uint page_size, uint cache_pages, texer_page_builder_t build, void* user) {
+    texer_virtual_t vt = {0};
+    vt.width     = width;
+    vt.height    = height;
+    vt.page_size = page_size;
+    vt.build     = build;
+    vt.user      = user;
+
+    unsigned long long pages = 0;
+    do {
+        uint span = page_size << vt.levels;
+        vt.level_start[vt.levels]   = pages;
+        vt.level_pages_x[vt.levels] = (width  + span - 1) / span;
+        vt.level_pages_y[vt.levels] = (height + span - 1) / span;
+        pages += (unsigned long long) vt.level_pages_x[vt.levels] * vt.level_pages_y[vt.levels];
+        vt.levels++;
+    } while ((page_size << (vt.levels - 1)) < max(width, height) && vt.levels < TEXER_VIRTUAL_MAX_LEVELS);
+
+    uint slots = 1;
+    while (slots < 2 * cache_pages) { slots *= 2; }
+
+    vt.cache           = texture_array(page_size, page_size, cache_pages);
+    vt.page_table      = malloc(slots * sizeof(texer_page_slot_t));
+    vt.page_table_mask = slots - 1;
+    vt.layer_page      = calloc(cache_pages, sizeof(unsigned long long));
+    vt.last_used       = calloc(cache_pages, sizeof(unsigned long long));
+    for (uint i = 0; i < slots; i++) { vt.page_table[i].layer = TEXER_PAGE_NONE; }
+
+    return vt;
+}
+
+static uint _page_home(const texer_virtual_t* vt, unsigned long long page) {
+    return (uint) ((page * 0x9E3779B97F4A7C15ull) >> 32) & vt->page_table_mask; /* fibonacci hashing */
+}
+/* slot that holds the page, or the empty slot where it would go. NOTE: the table is never more than half full */
+static uint _page_slot(const texer_virtual_t* vt, unsigned long long page) {
+    uint slot = _page_home(vt, page);
+    while (vt->page_table[slot].layer != TEXER_PAGE_NONE && vt->page_table[slot].page != page) { slot = (slot + 1) & vt->page_table_mask; }
+    return slot;
+}
+/* empty the slot and shift later entries of the probe sequence back, so lookups never need tombstones */
+static void _page_remove(texer_virtual_t* vt, uint slot) {
+    uint mask = vt->page_table_mask;
+    uint hole = slot;
+    for (uint next = (hole + 1) & mask; vt->page_table[next].layer != TEXER_PAGE_NONE; next = (next + 1) & mask) {
+        /* the entry may fill the hole unless its home slot lies between the hole and itself */
+        uint home = _page_home(vt, vt->page_table[next].page);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            vt->page_table[hole] = vt->page_table[next];
+            hole = next;
+        }
+    }
+    vt->page_table[hole].layer = TEXER_PAGE_NONE;
+}
+
+texture_t texer_sample_tile(texer_virtual_t* vt, uint x, uint y, uint lod) {
+    assert(lod < vt->levels);
+    assert(x < vt->level_pages_x[lod] && y < vt->level_pages_y[lod]);
+    unsigned long long page = vt->level_start[lod] + (unsigned long long) y * vt->level_pages_x[lod] + x;
+    uint slot  = _page_slot(vt, page);
+    uint layer = vt->page_table[slot].layer;
+
+    if (layer == TEXER_PAGE_NONE) {
+        /* take a free layer or evict the least recently used page */
+        layer = 0;
+        for (uint i = 0; i < vt->cache.tex.layers; i++) {
+            if (vt->last_used[i] == 0) { layer = i; break; }
+            if (vt->last_used[i] < vt->last_used[layer]) { layer = i; }
+        }
+        if (vt->last_used[layer] != 0) {
+            _page_remove(vt, _page_slot(vt, vt->layer_page[layer]));
+            slot = _page_slot(vt, page); /* the removal may have moved the empty slot */
+        }
+        vt->layer_page[layer]      = page;
+        vt->page_table[slot].page  = page;
+        vt->page_table[slot].layer = layer;
+
+        /* the root rect is the whole virtual texture, a scaling transform maps the page into it */
+        uint  size  = vt->page_size;
+        float scale = (float) (1u << lod);
+        texer_t builder = texture_layer(vt->cache, layer);
+        builder.mask.w  = vt->width;
+        builder.mask.h  = vt->height;
+        memset(vt->cache.tex.rgb + layer * size * size, 0, size * size * sizeof(color_t));
+
+        texer_affine_t m = texer_affine(1.0f / scale, 0, 0, 1.0f / scale, -(float) (x * size), -(float) (y * size));
+        for (uint pixel_y = 0; pixel_y < size; pixel_y++) {
+            for (uint pixel_x = 0; pixel_x < size; pixel_x++) {
+                texer_t temp = builder;
+                if (_push_transform(&temp, m, pixel_x, pixel_y).i == 0) { vt->build(temp, temp.transformed.x, temp.transformed.y, vt->user); }
+            }
+        }
+    }
+
+    vt->last_used[layer] = ++vt->clock;
+
+    texture_t tex = vt->cache.tex;
+    tex.rgb    += layer * vt->page_size * vt->page_size;
+    tex.layers  = 1;
+    return tex;
+}
+
+void texer_virtual_free(texer_virtual_t* vt) {
+    free(vt->cache.tex.rgb);
+    free(vt->page_table);
+    free(vt->layer_page);
+    free(vt->last_used);
+}
+
+/* point the builder at the layer of the current variant, returns 1 so it can be used in a loop condition */
+int _set_variant(texer_t* builder, const uint* seeds) {
+    builder->origin       = _origin(*builder, builder->layer);
+    builder->variant_seed = seeds[builder->layer];
+    builder->seed         = seeds[builder->layer];
+    return 1;
+}
+
 /* return copy of old builder, modify current builder's mask */
 texer_t _set_mask(texer_t* builder, uint x, uint y, uint width, uint height) {
     texer_t old = *builder;
@@ -362,9 +2411,494 @@ texer_t _set_mask(texer_t* builder, uint x, uint y, uint width, uint height) {
     return old;
 }
 
+/* called after entering a scope: multiply in the coverage of the scope's shape at the current pixel.
+ * if nothing of the scope is visible at this pixel, the builder is restored and the returned copy is
+ * marked as done, so the for-loop of the scope macro skips its body. */
+static texer_t _cull(texer_t* builder, texer_t old, int pixel_x, int pixel_y, float coverage) {
+    builder->coverage *= coverage;
+    if (!inside_region(*builder, pixel_x, pixel_y) || !(builder->coverage > 0.0f)) {
+        *builder = old;
+        old.i   += 1;
+    }
+    return old;
+}
+
+texer_t _push_rect(texer_t* builder, uint x, uint y, uint width, uint height, int pixel_x, int pixel_y) {
+    texer_t old = _set_mask(builder, x, y, width, height);
+    if (builder->program) { /* recording enters every rect */
+        _emit_op(builder->program, TEXER_OP_PUSH_RECT);
+        _emit_u32(builder->program, builder->mask.x);
+        _emit_u32(builder->program, builder->mask.y);
+        _emit_u32(builder->program, builder->mask.w);
+        _emit_u32(builder->program, builder->mask.h);
+        return old;
+    }
+    return _cull(builder, old, pixel_x, pixel_y, 1.0f);
+}
+
+/* called when leaving a rect, returns the builder to restore */
+texer_t _pop_rect(texer_t old) {
+    if (old.program) { _emit_op(old.program, TEXER_OP_POP); }
+    return old;
+}
+
+/* like a rect for the bounding box, additionally clips to the shape described by type */
+texer_t _push_sdf(texer_t* builder, uint type, int x, int y, int width, int height, int radius, int pixel_x, int pixel_y) {
+    if (builder->program) { /* can't be recorded, skip the body */
+        texer_t old = _unrecordable(*builder);
+        old.i += 1;
+        return old;
+    }
+    /* the shape is allowed to start before the current rect, only its bounding box gets cut off */
+    clipping_sdf_t shape = { type, builder->mask.x + x, builder->mask.y + y, min(radius, min(width, height) / 2), width, height };
+    if (x < 0) { width  += x; x = 0; }
+    if (y < 0) { height += y; y = 0; }
+
+    texer_t old = _set_mask(builder, x, y, max(width, 0), max(height, 0));
+    if (!inside_region(*builder, pixel_x, pixel_y)) { return _cull(builder, old, pixel_x, pixel_y, 0.0f); } /* don't bother with the sdf */
+
+    return _cull(builder, old, pixel_x, pixel_y, CLAMP(0.5f - sdf(shape, pixel_x, pixel_y), 0.0f, 1.0f));
+}
+
+texer_t _push_mask(texer_t* builder, texer_mask_t mask, int x, int y, int pixel_x, int pixel_y) {
+    if (builder->program) { /* can't be recorded, skip the body */
+        texer_t old = _unrecordable(*builder);
+        old.i += 1;
+        return old;
+    }
+    int mask_x = builder->mask.x + x;
+    int mask_y = builder->mask.y + y;
+    int width  = mask.width;
+    int height = mask.height;
+    if (x < 0) { width  += x; x = 0; }
+    if (y < 0) { height += y; y = 0; }
+
+    texer_t old = _set_mask(builder, x, y, max(width, 0), max(height, 0));
+    if (!inside_region(*builder, pixel_x, pixel_y)) { return _cull(builder, old, pixel_x, pixel_y, 0.0f); }
+
+    /* NOTE: per pixel, an empty tile costs a flag load and the cull, a full one skips the coverage byte */
+    return _cull(builder, old, pixel_x, pixel_y, _mask_coverage(mask, pixel_x - mask_x, pixel_y - mask_y));
+}
+
+texer_affine_t texer_affine(float a, float b, float c, float d, float tx, float ty) {
+    texer_affine_t m = { a, b, c, d, tx, ty };
+
+    float det = a * d - b * c;
+    float inv = (det != 0.0f) ? 1.0f / det : 0.0f; /* a degenerate map shows nothing */
+    m.inverse[0] =  d * inv;
+    m.inverse[1] = -b * inv;
+    m.inverse[2] = -c * inv;
+    m.inverse[3] =  a * inv;
+    m.inverse[4] = -(m.inverse[0] * tx + m.inverse[1] * ty);
+    m.inverse[5] = -(m.inverse[2] * tx + m.inverse[3] * ty);
+
+    return m;
+}
+
+texer_affine_t texer_rotation(float angle, float pivot_x, float pivot_y) {
+    float c = cosf(angle);
+    float s = sinf(angle);
+    return texer_affine(c, -s, s, c, pivot_x - (c * pivot_x - s * pivot_y), pivot_y - (s * pivot_x + c * pivot_y));
+}
+
+/* map the pixel back into content space. ops inside the scope see the content coordinates, while
+ * get_index is pinned to the pixel being visited (zero pitch and step), so writes still land on it */
+texer_t _push_transform(texer_t* builder, texer_affine_t m, int pixel_x, int pixel_y) {
+    if (builder->program) { /* can't be recorded, skip the body */
+        texer_t old = _unrecordable(*builder);
+        old.i += 1;
+        return old;
+    }
+    texer_t old = *builder;
+
+    /* sample at the pixel center */
+    float x = pixel_x + 0.5f - builder->mask.x;
+    float y = pixel_y + 0.5f - builder->mask.y;
+    float u = m.inverse[0] * x + m.inverse[1] * y + m.inverse[4];
+    float v = m.inverse[2] * x + m.inverse[3] * y + m.inverse[5];
+
+    builder->transformed.x = builder->mask.x + (int) floorf(u);
+    builder->transformed.y = builder->mask.y + (int) floorf(v);
+
+    builder->origin = get_index(*builder, pixel_x, pixel_y);
+    builder->pitch  = 0;
+    builder->step   = 0;
+
+    /* the scope macro restores the pixel from here on exit */
+    old.transformed.x = pixel_x;
+    old.transformed.y = pixel_y;
+
+    /* content outside of the rect is culled the same way a rect culls */
+    return _cull(builder, old, builder->transformed.x, builder->transformed.y, 1.0f);
+}
+
+/* zeroed mask, the padding of edge tiles stays empty. call _classify_tiles() once the coverage is written */
+static texer_mask_t _alloc_mask(uint width, uint height) {
+    texer_mask_t mask;
+    mask.width    = width;
+    mask.height   = height;
+    mask.tiles_x  = (width  + TEXER_TILE_SIZE - 1) / TEXER_TILE_SIZE;
+    uint tiles_y  = (height + TEXER_TILE_SIZE - 1) / TEXER_TILE_SIZE;
+    mask.tiles    = malloc(mask.tiles_x * tiles_y);
+    mask.coverage = calloc(mask.tiles_x * tiles_y, TEXER_TILE_SIZE * TEXER_TILE_SIZE);
+    return mask;
+}
+
+static inline unsigned char* _mask_texel(texer_mask_t mask, uint x, uint y) {
+    uint tile = (y / TEXER_TILE_SIZE) * mask.tiles_x + (x / TEXER_TILE_SIZE);
+    return mask.coverage + tile * TEXER_TILE_SIZE * TEXER_TILE_SIZE + (y % TEXER_TILE_SIZE) * TEXER_TILE_SIZE + (x % TEXER_TILE_SIZE);
+}
+
+static void _classify_tiles(texer_mask_t mask) {
+    uint tiles_y = (mask.height + TEXER_TILE_SIZE - 1) / TEXER_TILE_SIZE;
+    for (uint tile = 0; tile < mask.tiles_x * tiles_y; tile++) {
+        uint tile_x = (tile % mask.tiles_x) * TEXER_TILE_SIZE;
+        uint tile_y = (tile / mask.tiles_x) * TEXER_TILE_SIZE;
+        uint sum = 0, count = 0;
+
+        for (uint y = tile_y; y < min(tile_y + TEXER_TILE_SIZE, mask.height); y++) {
+            for (uint x = tile_x; x < min(tile_x + TEXER_TILE_SIZE, mask.width); x++) {
+                sum   += *_mask_texel(mask, x, y);
+                count += 1;
+            }
+        }
+
+        mask.tiles[tile] = (sum == 0) ? TEXER_TILE_EMPTY : (sum == count * 255) ? TEXER_TILE_FULL : TEXER_TILE_PARTIAL;
+    }
+}
+
+texer_mask_t texture_mask(texture_t tex) {
+    _assert_colors(tex);
+    texer_mask_t mask = _alloc_mask(tex.width, tex.height);
+
+    for (uint y = 0; y < tex.height; y++) {
+        for (uint x = 0; x < tex.width; x++) {
+            color_t c = tex.rgb[texture_index(tex, 0, x, y)]; /* read upright */
+            float brightness = CLAMP((c.r + c.g + c.b) / 3.0f, 0.0f, 1.0f);
+            *_mask_texel(mask, x, y) = (unsigned char) (brightness * 255.0f + 0.5f);
+        }
+    }
+    _classify_tiles(mask);
+
+    return mask;
+}
+
+/* squared euclidean distance transform of n samples in one row or column (Felzenszwalb & Huttenlocher),
+ * the lower envelope of the parabolas rooted at every sample makes it O(n). v and z are scratch of n and n+1 */
+static void _distance_1d(const float* f, float* d, int n, int* v, float* z) {
+    const float inf = 1e20f;
+    int k = 0;
+    v[0] = 0; z[0] = -inf; z[1] = inf;
+    for (int q = 1; q < n; q++) {
+        /* intersection with the rightmost parabola of the envelope, drop the ones that get hidden */
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+        while (s <= z[k]) {
+            k--;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+        }
+        k++;
+        v[k] = q; z[k] = s; z[k + 1] = inf;
+    }
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q) { k++; }
+        d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+}
+
+/* squared distance of every texel to the nearest texel of the field that is (inside == wanted) */
+static float* _distance_2d(const unsigned char* inside, uint w, uint h, int wanted) {
+    uint n = max(w, h);
+    float* grid = malloc(w * h * sizeof(float));
+    float* f    = malloc(n * sizeof(float));
+    float* d    = malloc(n * sizeof(float));
+    int*   v    = malloc(n * sizeof(int));
+    float* z    = malloc((n + 1) * sizeof(float));
+
+    for (uint i = 0; i < w * h; i++) { grid[i] = (inside[i] == wanted) ? 0.0f : 1e20f; }
+
+    /* columns, then rows */
+    for (uint x = 0; x < w; x++) {
+        for (uint y = 0; y < h; y++) { f[y] = grid[y * w + x]; }
+        _distance_1d(f, d, h, v, z);
+        for (uint y = 0; y < h; y++) { grid[y * w + x] = d[y]; }
+    }
+    for (uint y = 0; y < h; y++) {
+        memcpy(f, grid + y * w, w * sizeof(float));
+        _distance_1d(f, grid + y * w, w, v, z);
+    }
+
+    free(f); free(d); free(v); free(z);
+    return grid;
+}
+
+texer_field_t texture_distance(texer_mask_t mask, uint padding) {
+    texer_field_t field;
+    field.width    = mask.width  + 2 * padding;
+    field.height   = mask.height + 2 * padding;
+    field.padding  = padding;
+    field.distance = malloc(field.width * field.height * sizeof(float));
+
+    /* the padding is outside */
+    unsigned char* inside = calloc(field.width * field.height, 1);
+    for (uint y = 0; y < mask.height; y++) {
+        for (uint x = 0; x < mask.width; x++) {
+            inside[(y + padding) * field.width + (x + padding)] = (_mask_coverage(mask, x, y) >= 0.5f);
+        }
+    }
+
+    float* to_inside  = _distance_2d(inside, field.width, field.height, 1);
+    float* to_outside = _distance_2d(inside, field.width, field.height, 0);
+
+    /* distances are between pixel centers, the edge is half a pixel in between */
+    for (uint i = 0; i < field.width * field.height; i++) {
+        field.distance[i] = inside[i] ? 0.5f - sqrtf(to_outside[i]) : sqrtf(to_inside[i]) - 0.5f;
+    }
+
+    free(inside); free(to_inside); free(to_outside);
+    return field;
+}
+
+texture_t texture_sdf(texer_field_t field, float spread) {
+    texture_t tex = texture(field.width, field.height).tex;
+    for (uint i = 0; i < field.width * field.height; i++) {
+        float value = CLAMP(0.5f - field.distance[i] / (2.0f * spread), 0.0f, 1.0f);
+        tex.rgb[i] = (color_t){ value, value, value, 1.0f };
+    }
+    return tex;
+}
+
+/* builtin 3x5 pixel font for ASCII 32 (space) to 95 (underscore), one octal digit per row from
+ * the top, the highest bit of a digit is the leftmost pixel */
+static const unsigned short _font_glyphs[64] = {
+    000000, 022202, 055000, 057575, 036236, 041241, 025253, 022000, /*   ! " # $ % & ' */
+    012221, 042224, 005250, 002720, 000024, 000700, 000002, 011244, /* ( ) * + , - . / */
+    075557, 026227, 071747, 071317, 055711, 074717, 074757, 071122, /* 0 1 2 3 4 5 6 7 */
+    075757, 075717, 002020, 002024, 012421, 007070, 042124, 071302, /* 8 9 : ; < = > ? */
+    025743, 025755, 065656, 034443, 065556, 074647, 074644, 034553, /* @ A B C D E F G */
+    055755, 072227, 011152, 055655, 044447, 057755, 065555, 025552, /* H I J K L M N O */
+    065644, 025563, 065655, 034216, 072222, 055557, 055552, 055775, /* P Q R S T U V W */
+    055255, 055222, 071247, 064446, 044211, 031113, 025000, 000007, /* X Y Z [ \ ] ^ _ */
+};
+
+texer_font_t texer_font(uint size) {
+    texer_font_t font;
+    float unit = size / 5.0f;  /* size of one font pixel */
+    font.glyph_w = (uint) ceilf(4.0f * unit); /* one font pixel of spacing to the right ... */
+    font.glyph_h = (uint) ceilf(6.0f * unit); /* ... and below */
+    font.atlas   = _alloc_mask(64 * font.glyph_w, font.glyph_h);
+
+    /* 4x4 supersampling, so that sizes that are not a multiple of 5 get anti-aliased edges */
+    for (uint glyph = 0; glyph < 64; glyph++) {
+        for (uint y = 0; y < font.glyph_h; y++) {
+            for (uint x = 0; x < font.glyph_w; x++) {
+                uint hits = 0;
+                for (uint s = 0; s < 16; s++) {
+                    uint col = (uint) ((x + ((s % 4) + 0.5f) / 4.0f) / unit);
+                    uint row = (uint) ((y + ((s / 4) + 0.5f) / 4.0f) / unit);
+                    if (col < 3 && row < 5) { hits += (_font_glyphs[glyph] >> ((4 - row) * 3 + (2 - col))) & 1; }
+                }
+                *_mask_texel(font.atlas, glyph * font.glyph_w + x, y) = (unsigned char) ((hits * 255) / 16);
+            }
+        }
+    }
+    _classify_tiles(font.atlas);
+
+    return font;
+}
+
+texer_text_t texer_text(texer_font_t font, const char* str) {
+    return (texer_text_t) { font, str, (uint) strlen(str) };
+}
+
+/* does the segment come close enough to the cell to touch one of its pixels */
+static int _segment_touches_cell(const float* s, float reach, int cell_x, int cell_y) {
+    float half = 0.5f * TEXER_LINES_CELL_SIZE;
+    float cx   = cell_x + half;
+    float cy   = cell_y + half;
+    return _segment_distance(cx, cy, s[0], s[1], s[2], s[3]) <= reach + half * 1.41421356f; /* half diagonal */
+}
+
+texer_lines_t texer_lines(const float* segments, uint count, float thickness) {
+    texer_lines_t batch;
+    float reach = 0.5f * thickness + 0.5f;
+
+    batch.thickness = thickness;
+    batch.segments  = malloc(count * 4 * sizeof(float));
+    memcpy(batch.segments, segments, count * 4 * sizeof(float));
+
+    /* grid covers the bounding box of all segments */
+    float lo_x = 0, lo_y = 0, hi_x = 0, hi_y = 0;
+    for (uint i = 0; i < count; i++) {
+        const float* s = segments + 4 * i;
+        if (i == 0) { lo_x = hi_x = s[0]; lo_y = hi_y = s[1]; }
+        lo_x = min(lo_x, min(s[0], s[2])); hi_x = max(hi_x, max(s[0], s[2]));
+        lo_y = min(lo_y, min(s[1], s[3])); hi_y = max(hi_y, max(s[1], s[3]));
+    }
+    batch.x       = (int) floorf(lo_x - reach);
+    batch.y       = (int) floorf(lo_y - reach);
+    batch.cells_x = (uint) ((int) ceilf(hi_x + reach) - batch.x) / TEXER_LINES_CELL_SIZE + 1;
+    batch.cells_y = (uint) ((int) ceilf(hi_y + reach) - batch.y) / TEXER_LINES_CELL_SIZE + 1;
+
+    uint cell_count  = batch.cells_x * batch.cells_y;
+    batch.cell_start = calloc(cell_count + 1, sizeof(uint));
+
+    /* two passes over the cells of every segment's bounding box: count, then fill */
+    uint* fill = NULL;
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint i = 0; i < count; i++) {
+            const float* s = segments + 4 * i;
+            int first_x = ((int) floorf(min(s[0], s[2]) - reach) - batch.x) / TEXER_LINES_CELL_SIZE;
+            int first_y = ((int) floorf(min(s[1], s[3]) - reach) - batch.y) / TEXER_LINES_CELL_SIZE;
+            int last_x  = ((int) ceilf (max(s[0], s[2]) + reach) - batch.x) / TEXER_LINES_CELL_SIZE;
+            int last_y  = ((int) ceilf (max(s[1], s[3]) + reach) - batch.y) / TEXER_LINES_CELL_SIZE;
+            for (int y = first_y; y <= last_y; y++) {
+                for (int x = first_x; x <= last_x; x++) {
+                    if (!_segment_touches_cell(s, reach, batch.x + x * TEXER_LINES_CELL_SIZE, batch.y + y * TEXER_LINES_CELL_SIZE)) { continue; }
+                    uint cell = y * batch.cells_x + x;
+                    if (pass == 0) { batch.cell_start[cell + 1] += 1; }
+                    else           { batch.cell_segments[fill[cell]++] = i; }
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (uint cell = 0; cell < cell_count; cell++) { batch.cell_start[cell + 1] += batch.cell_start[cell]; }
+            batch.cell_segments = malloc(max(batch.cell_start[cell_count], 1) * sizeof(uint));
+            fill = malloc(cell_count * sizeof(uint));
+            memcpy(fill, batch.cell_start, cell_count * sizeof(uint));
+        }
+    }
+    free(fill);
+
+    return batch;
+}
+
+texer_lines_t texer_polyline(const float* points, uint count, float thickness) {
+    uint segment_count = (count > 1) ? count - 1 : 0;
+    float* segments = malloc(max(segment_count, 1) * 4 * sizeof(float));
+    for (uint i = 0; i < segment_count; i++) { memcpy(segments + 4 * i, points + 2 * i, 4 * sizeof(float)); }
+
+    texer_lines_t batch = texer_lines(segments, segment_count, thickness);
+    free(segments);
+    return batch;
+}
+
+texer_t _record(texer_program_t* program, texer_t builder) {
+    program->size         = 0;
+    program->unrecordable = 0;
+    builder.program       = program;
+    builder.i       = 0;
+
+    /* every write lands on the scratch pixel */
+    builder.tex.rgb = &program->scratch;
+    builder.origin  = 0;
+    builder.pitch   = 0;
+    builder.step    = 0;
+    builder.targets.height    = NULL;
+    builder.targets.roughness = NULL;
+    builder.targets.fixed     = NULL;
+    return builder;
+}
+
+/* color() over the pixels x0 to x1 of a row. NOTE: for plain alpha blending into contiguous floats the
+ * loop has no dependencies between pixels, so the compiler can vectorize it */
+static void _color_span(texer_t tex, color_t color, int x0, int x1, int y) {
+    if (tex.blend == alpha_blend && tex.step == 1 && !tex.targets.fixed && !tex.targets.height && !tex.targets.roughness) {
+        color.a *= tex.coverage;
+        color_t* row = tex.tex.rgb + get_index(tex, x0, y);
+        for (int i = 0; i < x1 - x0; i++) { row[i] = alpha_blend(color, row[i]); }
+        return;
+    }
+    for (int x = x0; x < x1; x++) { tex = _color(tex, x, y, color); }
+}
+
+int texer_program_run(texer_t builder, texer_program_t program, int x, int y, int w, int h) {
+    static const unsigned char operands[TEXER_OP_COUNT] = { 4, 0, 4, 1, 5, 1, 1, 1, 1, 1 };
+    if (program.unrecordable) { return 0; } /* drawing what was recorded of it would be wrong */
+
+    texer_t stack[TEXER_PROGRAM_MAX_DEPTH];
+    uint    depth = 0;
+    texer_t tex   = builder;
+
+    /* the tile, clipped to the texture */
+    int tile_x0 = max(x, 0), tile_x1 = min(x + w, (int) builder.atlas_width);
+    int tile_y0 = max(y, 0), tile_y1 = min(y + h, (int) builder.atlas_height);
+
+    for (size_t pc = 0; pc < program.size; ) {
+        unsigned char op = program.code[pc++];
+        if (op >= TEXER_OP_COUNT || pc + 4 * operands[op] > program.size) { return 0; }
+        const unsigned char* args = program.code + pc;
+        pc += 4 * operands[op];
+
+        switch (op) {
+            case TEXER_OP_PUSH_RECT : {
+                if (depth == TEXER_PROGRAM_MAX_DEPTH) { return 0; }
+                stack[depth++] = tex;
+                tex.mask.x = (int) _read_u32(args);
+                tex.mask.y = (int) _read_u32(args + 4);
+                tex.mask.w = (int) _read_u32(args + 8);
+                tex.mask.h = (int) _read_u32(args + 12);
+                continue;
+            } break;
+            case TEXER_OP_POP : {
+                if (depth == 0) { return 0; }
+                tex = stack[--depth];
+                continue;
+            } break;
+            case TEXER_OP_SEED : {
+                tex.seed = _read_u32(args);
+                continue;
+            } break;
+            case TEXER_OP_BLEND : {
+                uint mode = _read_u32(args);
+                if (mode >= TEXER_BLEND_COUNT) { return 0; }
+                tex.blend = texer_blend_modes[mode];
+                continue;
+            } break;
+            case TEXER_OP_HEIGHT : {
+                tex.material.height = _read_float(args);
+                continue;
+            } break;
+            case TEXER_OP_ROUGHNESS : {
+                tex.material.roughness = _read_float(args);
+                continue;
+            } break;
+        }
+
+        /* the part of the tile inside the current rect */
+        int x0 = max(tile_x0, tex.mask.x), x1 = min(tile_x1, tex.mask.x + tex.mask.w);
+        int y0 = max(tile_y0, tex.mask.y), y1 = min(tile_y1, tex.mask.y + tex.mask.h);
+
+        for (int pixel_y = y0; pixel_y < y1; pixel_y++) {
+            switch (op) {
+                case TEXER_OP_COLOR : {
+                    _color_span(tex, _read_color(args), x0, x1, pixel_y);
+                } break;
+                case TEXER_OP_NOISE : {
+                    float intensity = _read_float(args);
+                    for (int pixel_x = x0; pixel_x < x1; pixel_x++) { tex = _noise(tex, pixel_x, pixel_y, intensity); }
+                } break;
+                case TEXER_OP_OUTLINE : {
+                    color_t color  = _read_color(args);
+                    uint thickness = _read_u32(args + 16);
+                    for (int pixel_x = x0; pixel_x < x1; pixel_x++) { tex = _outline(tex, pixel_x, pixel_y, color, thickness); }
+                } break;
+                case TEXER_OP_VORONOI : {
+                    uint seed_points = _read_u32(args);
+                    for (int pixel_x = x0; pixel_x < x1; pixel_x++) { tex = _voronoi(tex, pixel_x, pixel_y, seed_points); }
+                } break;
+            }
+        }
+    }
+
+    return depth == 0;
+}
+
 texer_t _pixel(texer_t tex) {
+   if (tex.program) { return _unrecordable(tex); }
    uint index = get_index(tex, tex.mask.x, tex.mask.y);
-   tex.tex.rgb[index] = (color_t){1,1,1,1};
+   _set_pixel(tex, index, (color_t){1,1,1,1});
    return tex;
 }
 